@@ -0,0 +1,390 @@
+/** 
+ * AdaptiveHuffman.cc
+ *
+ * Class methods and implementation
+ * for single pass adaptive coding
+ */
+
+// Include header file
+#include "AdaptiveHuffman.hh"
+
+/** 
+ * AdaptiveHuffman()
+ *
+ * Default constructor
+ */
+AdaptiveHuffman::AdaptiveHuffman() {
+    reset();
+}
+
+/** 
+ * reset()
+ *
+ * Returns to a tree holding only the
+ * not-yet-transmitted leaf at the root
+ */
+void AdaptiveHuffman::reset() {
+    for( int s = 0; s <= NUM_SYMBOLS; s++ ) {
+        leaves[s] = -1;
+    }
+
+    escape = ROOT;
+
+    nodes[ROOT].weight = 0;
+    nodes[ROOT].left   = -1;
+    nodes[ROOT].right  = -1;
+    nodes[ROOT].symbol = NOT_YET_TRANSMITTED;
+    parents[ROOT]      = -1;
+    leaves[NOT_YET_TRANSMITTED] = ROOT;
+
+    startSymbol();
+}
+
+/** 
+ * writeHeader()
+ *
+ * Writes magic and version.
+ * Returns number of bytes written
+ */
+size_t AdaptiveHuffman::writeHeader( unsigned char *p ) {
+    p[0] = 'H';
+    p[1] = 'U';
+    p[2] = 'A';
+    p[3] = VERSION;
+
+    return MAGIC_SIZE;
+}
+
+/** 
+ * checkMagic()
+ *
+ * Returns false if this is not an adaptive
+ * stream this version can read
+ */
+bool AdaptiveHuffman::checkMagic( const unsigned char *p ) {
+    return p[0] == 'H' && p[1] == 'U' && p[2] == 'A' && p[3] == VERSION;
+}
+
+/** 
+ * encodeBound()
+ *
+ * Returns most bytes written for size symbols
+ * followed by a flush or end marker, with the
+ * spare word a memory writer needs
+ */
+size_t AdaptiveHuffman::encodeBound( size_t size ) {
+    return ( ( size + 1 ) * MAX_SYMBOL_BITS + 7 ) / 8 + 8;
+}
+
+/** 
+ * encode()
+ *
+ * Writes the code of every byte and updates the tree
+ * after each. A byte seen for the first time is sent
+ * raw after the code of the not-yet-transmitted leaf
+ */
+void AdaptiveHuffman::encode( const unsigned char *src, size_t size, BitIO &writer ) {
+    for( size_t i = 0; i < size; i++ ) {
+        int symbol = src[i];
+
+        if( leaves[symbol] < 0 ) {
+            writeEscape( symbol, writer );
+        } else {
+            writeCode( leaves[symbol], writer );
+        }
+
+        update( symbol );
+    }
+}
+
+/** 
+ * flush()
+ *
+ * Writes a flush marker and pads to a whole byte,
+ * so the decoder can finish every symbol so far
+ * from the bytes written up to here
+ */
+void AdaptiveHuffman::flush( BitIO &writer ) {
+    writeEscape( FLUSH, writer );
+    writer.pad();
+}
+
+/** 
+ * finish()
+ *
+ * Writes the end marker and pads to a whole byte
+ */
+void AdaptiveHuffman::finish( BitIO &writer ) {
+    writeEscape( END, writer );
+    writer.pad();
+}
+
+/** 
+ * decode()
+ *
+ * Walks the tree a bit at a time through the bytes
+ * given, appending every symbol completed to out.
+ * A symbol may be split between calls. Bits after
+ * a flush marker up to the next byte are skipped
+ */
+AdaptiveStatus AdaptiveHuffman::decode( const unsigned char *src, size_t size, std::vector<unsigned char> &out ) {
+    for( size_t i = 0; i < size; i++ ) {
+        for( int bit = 7; bit >= 0; bit-- ) {
+            int value = ( src[i] >> bit ) & 1;
+
+            // Raw bits of a new symbol or marker
+            if( escapeBits > 0 ) {
+                escapeValue = ( escapeValue << 1 ) | value;
+
+                if( --escapeBits > 0 ) {
+                    continue;
+                }
+
+                int marker = escapeValue;
+
+                if( marker < NUM_SYMBOLS ) {
+                    out.push_back( (unsigned char) marker );
+                    update( marker );
+                } else if( marker == END ) {
+                    return ADAPTIVE_END;
+                } else if( marker != FLUSH ) {
+                    return ADAPTIVE_CORRUPT;
+                }
+
+                startSymbol();
+
+                // Padding follows a flush
+                if( marker == FLUSH ) {
+                    break;
+                }
+
+                continue;
+            }
+
+            // Step down the tree
+            position = value ? nodes[position].right : nodes[position].left;
+
+            if( nodes[position].left >= 0 ) {
+                continue;
+            }
+
+            if( position == escape ) {
+                escapeBits  = ESCAPE_BITS;
+                escapeValue = 0;
+            } else {
+                int symbol = nodes[position].symbol;
+
+                out.push_back( (unsigned char) symbol );
+                update( symbol );
+                startSymbol();
+            }
+        }
+    }
+
+    return ADAPTIVE_MORE;
+}
+
+/** 
+ * writeCode()
+ *
+ * Collects the path from a node up to the root,
+ * last bit first, then writes it root first
+ */
+void AdaptiveHuffman::writeCode( int node, BitIO &writer ) {
+    // Function variables
+    unsigned long long words[NUM_SYMBOLS / BitIO::MAX_BITS + 1];
+    int                lengths[NUM_SYMBOLS / BitIO::MAX_BITS + 1];
+    int                n = 0;
+
+    words[0]   = 0;
+    lengths[0] = 0;
+
+    while( parents[node] >= 0 ) {
+        int parent = parents[node];
+
+        // Start a new word once this one is full
+        if( lengths[n] == BitIO::MAX_BITS ) {
+            n++;
+            words[n]   = 0;
+            lengths[n] = 0;
+        }
+
+        words[n] |= (unsigned long long) ( nodes[parent].right == node ) << lengths[n];
+        lengths[n]++;
+
+        node = parent;
+    }
+
+    for( int i = n; i >= 0; i-- ) {
+        writer.writeBits( words[i], lengths[i] );
+    }
+}
+
+/** 
+ * writeEscape()
+ *
+ * Writes the code of the not-yet-transmitted
+ * leaf followed by a raw symbol or marker
+ */
+void AdaptiveHuffman::writeEscape( int value, BitIO &writer ) {
+    writeCode( escape, writer );
+    writer.writeBits( value, ESCAPE_BITS );
+}
+
+/** 
+ * update()
+ *
+ * Vitter's update after coding a symbol. A new symbol
+ * splits the not-yet-transmitted leaf into an internal
+ * node over itself and the new leaf. Otherwise the leaf
+ * first swaps with the highest numbered leaf of its
+ * weight. Each node on the way to the root then slides
+ * past the block it would overtake and is incremented.
+ * A leaf whose sibling is the not-yet-transmitted leaf
+ * is incremented last, after its parent
+ */
+void AdaptiveHuffman::update( int symbol ) {
+    // Function variables
+    int node            = leaves[symbol];
+    int leafToIncrement = -1;
+
+    if( node < 0 ) {
+        // Split escape leaf, keeping its position for the new parent
+        int parent = escape;
+        int leaf   = escape - 1;
+
+        escape -= 2;
+
+        nodes[leaf].weight = 0;
+        nodes[leaf].left   = -1;
+        nodes[leaf].right  = -1;
+        nodes[leaf].symbol = symbol;
+        parents[leaf]      = parent;
+
+        nodes[escape].weight = 0;
+        nodes[escape].left   = -1;
+        nodes[escape].right  = -1;
+        nodes[escape].symbol = NOT_YET_TRANSMITTED;
+        parents[escape]      = parent;
+
+        nodes[parent].left   = escape;
+        nodes[parent].right  = leaf;
+        nodes[parent].symbol = -1;
+
+        leaves[symbol]              = leaf;
+        leaves[NOT_YET_TRANSMITTED] = escape;
+
+        node            = parent;
+        leafToIncrement = leaf;
+    } else {
+        // Highest numbered leaf of the same weight
+        int leader = node;
+
+        while( leader < ROOT && nodes[leader + 1].left < 0 && nodes[leader + 1].weight == nodes[node].weight ) {
+            leader++;
+        }
+
+        swapNodes( node, leader );
+        node = leader;
+
+        if( parents[node] == parents[escape] ) {
+            leafToIncrement = node;
+            node            = parents[node];
+        }
+    }
+
+    while( node >= 0 ) {
+        node = slideAndIncrement( node );
+    }
+
+    if( leafToIncrement >= 0 ) {
+        slideAndIncrement( leafToIncrement );
+    }
+}
+
+/** 
+ * slideAndIncrement()
+ *
+ * Moves a node above the block it is about to join: a
+ * leaf past the internal nodes of its weight, an internal
+ * node past the leaves one heavier. Those nodes each move
+ * down one position. Increments the node and returns the
+ * next node to update, the new parent of a leaf or the
+ * old parent of an internal node
+ */
+int AdaptiveHuffman::slideAndIncrement( int node ) {
+    // Function variables
+    AdaptiveNode       moving = nodes[node];
+    bool               leaf   = moving.left < 0;
+    unsigned long long weight = leaf ? moving.weight : moving.weight + 1;
+    int                parent = parents[node];
+    int                last   = node;
+
+    // Block to slide past
+    while( last < ROOT && ( nodes[last + 1].left < 0 ) != leaf && nodes[last + 1].weight == weight ) {
+        last++;
+    }
+
+    // Shift block down one position and place node above it
+    for( int i = node; i < last; i++ ) {
+        nodes[i] = nodes[i + 1];
+        attach( i );
+    }
+
+    nodes[last] = moving;
+    nodes[last].weight++;
+    attach( last );
+
+    return leaf ? parents[last] : parent;
+}
+
+/** 
+ * swapNodes()
+ *
+ * Exchanges the contents of two positions
+ */
+void AdaptiveHuffman::swapNodes( int a, int b ) {
+    if( a == b ) {
+        return;
+    }
+
+    AdaptiveNode temp = nodes[a];
+
+    nodes[a] = nodes[b];
+    nodes[b] = temp;
+
+    attach( a );
+    attach( b );
+}
+
+/** 
+ * attach()
+ *
+ * Points the children or the leaf map at the
+ * position now holding a node's contents
+ */
+void AdaptiveHuffman::attach( int node ) {
+    if( nodes[node].left >= 0 ) {
+        parents[nodes[node].left]  = node;
+        parents[nodes[node].right] = node;
+    } else {
+        leaves[nodes[node].symbol] = node;
+    }
+}
+
+/** 
+ * startSymbol()
+ *
+ * Returns the decoder to the root. Before the first
+ * symbol the root is the escape leaf, whose code is
+ * empty, so raw bits follow at once
+ */
+void AdaptiveHuffman::startSymbol() {
+    position    = ROOT;
+    escapeBits  = 0;
+    escapeValue = 0;
+
+    if( nodes[ROOT].left < 0 ) {
+        escapeBits = ESCAPE_BITS;
+    }
+}
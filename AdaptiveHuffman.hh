@@ -0,0 +1,109 @@
+/** 
+ * AdaptiveHuffman.hh
+ *
+ * Class definitions
+ */
+
+#ifndef ADAPTIVEHUFFMAN_HH
+#define ADAPTIVEHUFFMAN_HH
+
+// Include libraries
+#include <cstddef>
+#include <vector>
+
+// Include classes
+#include "BitIO.hh"
+
+/** 
+ * AdaptiveStatus
+ *
+ * Outcome of feeding coded bytes to the decoder
+ */
+enum AdaptiveStatus {
+    ADAPTIVE_MORE = 0,                                              // Every byte used, stream continues
+    ADAPTIVE_END,                                                   // End marker reached
+    ADAPTIVE_CORRUPT                                                // Escape names no symbol or marker
+};
+
+/** 
+ * AdaptiveNode
+ *
+ * Contents of one position in the adaptive tree
+ */
+struct AdaptiveNode {
+    unsigned long long weight;                                      // Symbols coded below this node
+    int                left;                                        // Number of 0 child, -1 for a leaf
+    int                right;                                       // Number of 1 child, -1 for a leaf
+    int                symbol;                                      // Byte of a leaf, NOT_YET_TRANSMITTED or -1
+};
+
+/** 
+ * AdaptiveHuffman
+ *
+ * Single pass Huffman coding with Vitter's algorithm.
+ * Encoder and decoder start from the same empty tree
+ * and update it after every symbol, so no table is sent
+ * and each symbol is written as soon as it is read.
+ *
+ *   header        "HUA", version
+ *   symbol        code of its leaf, or the code of the
+ *                 not-yet-transmitted leaf and 9 raw bits
+ *   flush         escape with value 256, then zeros to a byte
+ *   end           escape with value 257, then zeros to a byte
+ *
+ * Nodes are kept in implicit numbering: weights never
+ * decrease with the number and, within a weight, leaves
+ * come before internal nodes. The root has the highest
+ * number and the not-yet-transmitted leaf the lowest.
+ * The decoder is fed bytes as they arrive and keeps its
+ * place in the tree between calls
+ */
+class AdaptiveHuffman {
+    public:
+        static const int    VERSION       = 1;                      // Stream version written
+        static const size_t MAGIC_SIZE    = 4;                      // Bytes of magic and version
+        static const int    NUM_SYMBOLS   = 256;                    // Byte alphabet
+        static const int    NOT_YET_TRANSMITTED = NUM_SYMBOLS;      // Symbol of the escape leaf
+        static const int    MAX_NODES     = 2 * ( NUM_SYMBOLS + 1 ) - 1;
+        static const int    ROOT          = MAX_NODES - 1;          // Number of the root
+        static const int    ESCAPE_BITS   = 9;                      // Raw bits after the escape code
+        static const int    FLUSH         = NUM_SYMBOLS;            // Escape value padding to a byte
+        static const int    END           = NUM_SYMBOLS + 1;        // Escape value ending the stream
+        static const int    MAX_SYMBOL_BITS = NUM_SYMBOLS + ESCAPE_BITS;
+
+        AdaptiveHuffman();                                          // Default constructor: empty tree
+
+        void reset();                                               // Returns to the empty tree
+
+        static size_t writeHeader( unsigned char *p );              // Returns bytes written
+        static bool   checkMagic( const unsigned char *p );         // Checks magic and version
+        static size_t encodeBound( size_t size );                   // Largest output for size bytes and a flush
+
+        void encode( const unsigned char *src, size_t size,         // Codes bytes, updating the tree
+                     BitIO &writer );
+        void flush( BitIO &writer );                                // Ends everything so far on a whole byte
+        void finish( BitIO &writer );                               // Writes end marker on a whole byte
+
+        AdaptiveStatus decode( const unsigned char *src, size_t size,   // Decodes bytes as they arrive
+                               std::vector<unsigned char> &out );
+
+    private:
+        void writeCode( int node, BitIO &writer );                  // Writes path from root to a node
+        void writeEscape( int value, BitIO &writer );               // Writes escape code and raw value
+        void update( int symbol );                                  // Counts a symbol, keeps numbering
+        int  slideAndIncrement( int node );                         // Moves node past its block, returns next
+        void swapNodes( int a, int b );                             // Exchanges contents of two positions
+        void attach( int node );                                    // Points children and leaf map at a position
+        void startSymbol();                                         // Returns decoder to the root
+
+        AdaptiveNode nodes[MAX_NODES];                              // Contents by number
+        int          parents[MAX_NODES];                            // Parent of each position, -1 for root
+        int          leaves[NUM_SYMBOLS + 1];                       // Number of each symbol's leaf, -1 if unseen
+        int          escape;                                        // Number of not-yet-transmitted leaf
+
+        int          position;                                      // Decoder: node reached so far
+        int          escapeBits;                                    // Decoder: raw bits still to read
+        int          escapeValue;                                   // Decoder: raw bits read so far
+};
+
+#endif
@@ -14,10 +14,16 @@
  */
 BitIO::BitIO() {
     // Set default members
-    byte    = 0;
-    numBits = 0;
-    input   = NULL;
-    output  = NULL;
+    bitBuffer  = 0;
+    bufferBits = 0;
+    bitsRead   = 0;
+    bufferPos  = 0;
+    bufferEnd  = 0;
+    overflow   = false;
+    buffer     = NULL;
+    bufferSize = 0;
+    input      = NULL;
+    output     = NULL;
 }
 
 /** 
@@ -27,9 +33,18 @@ BitIO::BitIO() {
  */
 BitIO::BitIO( std::ifstream &input ) {
     // Set default members
-    byte    = 0;
-    numBits = 0;
-    output  = NULL;
+    bitBuffer  = 0;
+    bufferBits = 0;
+    bitsRead   = 0;
+    bufferPos  = 0;
+    bufferEnd  = 0;
+    overflow   = false;
+    output     = NULL;
+
+    // Allocate byte buffer, filled on first read
+    storage.resize( BUFFER_SIZE );
+    buffer     = &storage[0];
+    bufferSize = storage.size();
 
     // Set input file stream
     this -> input   = &input;
@@ -42,143 +57,150 @@ BitIO::BitIO( std::ifstream &input ) {
  */
 BitIO::BitIO( std::ofstream &output ) {
     // Set default members
-    byte    = 0;
-    numBits = 0;
-    input   = NULL;
+    bitBuffer  = 0;
+    bufferBits = 0;
+    bitsRead   = 0;
+    bufferPos  = 0;
+    bufferEnd  = 0;
+    overflow   = false;
+    input      = NULL;
+
+    // Allocate byte buffer
+    storage.resize( BUFFER_SIZE );
+    buffer     = &storage[0];
+    bufferSize = storage.size();
 
     // Set output file stream
     this -> output  = &output;
 }
 
 /** 
- * getNumBits()
+ * BitIO()
  *
- * Returns number of bits currently in buffer
- * 0 <= n <= 7
+ * Memory reader constructor. Reads size
+ * bytes starting at data
  */
-int BitIO::getNumBits() {
-    return numBits;
+BitIO::BitIO( const unsigned char *data, size_t size ) {
+    // Set default members
+    bitBuffer  = 0;
+    bufferBits = 0;
+    bitsRead   = 0;
+    bufferPos  = 0;
+    overflow   = false;
+    input      = NULL;
+    output     = NULL;
+
+    // Whole input is already buffered
+    buffer     = (unsigned char *) data;
+    bufferSize = size;
+    bufferEnd  = size;
 }
 
 /** 
- * reset()
+ * BitIO()
  *
- * Resets buffer to zero
+ * Memory writer constructor. Each store writes a whole
+ * word, so capacity must include 8 bytes beyond the
+ * last byte of output
  */
-void BitIO::reset() {
-    byte    = 0;
-    numBits = 0;
+BitIO::BitIO( unsigned char *data, size_t capacity ) {
+    // Set default members
+    bitBuffer  = 0;
+    bufferBits = 0;
+    bitsRead   = 0;
+    bufferPos  = 0;
+    bufferEnd  = 0;
+    overflow   = false;
+    input      = NULL;
+    output     = NULL;
+
+    // Write straight into caller memory
+    buffer     = data;
+    bufferSize = capacity;
 }
 
 /** 
- * writeSymbol()
+ * getNumBits()
  *
- * Main function to write a char to a file
- * Passes a binary bit to writeBit()
+ * Returns number of bits currently in accumulator.
+ * For a writer this is 0 <= n <= 7
  */
-void BitIO::writeSymbol( char character ) {
-    // Function variables
-    unsigned char bit  = 0, 
-                  mask = 1 << 7;
-
-    // Need to pass character bitwise
-
-    // Length of char is 8 bits
-    for( int i = 0; i < 8; i++ ) {
-        bit = 0;
-
-        if( character & mask ) {
-            bit = 1;
-        }
-
-        // Send to writeBit()
-        writeBit( bit );
+int BitIO::getNumBits() {
+    return bufferBits;
+}
 
-        // Bit shift!
-        character <<= 1;
-    }
+/** 
+ * reset()
+ *
+ * Resets accumulator to zero
+ */
+void BitIO::reset() {
+    bitBuffer  = 0;
+    bufferBits = 0;
 }
 
 /** 
  * writeBit()
  *
- * Subroutine to actually write bytes to file
+ * Writes a single binary bit to file
  */
 void BitIO::writeBit( char bit ) {
-    // Shift byte to left by one
-    byte <<= 1;
-
-    // Swap the LSB for 1 if needed
-    if( bit ) {
-        byte |= 1;
-    }
-
-    // Incrememt counter
-    numBits++;
-
-    // Write byte to file if buffer is full
-    //   number of bits in char == 8
-    if( numBits == 8 ) {
-        output -> put( byte );
-
-        // Reset buffer
-        reset();
-    }
+    writeBits( bit ? 1 : 0, 1 );
 }
 
 /** 
  * pad()
  *
- * Checks if buffer needs padding and pads
+ * Checks if accumulator needs padding and pads
  * appropriately. Returns amount of padding
  * added
  */
 int BitIO::pad() {
     int temp = 0;
 
-    // If previous call to writeBit() wrote a byte
-    // then numBits is reset to zero
-    if( numBits != 0 ) {
+    // Whole bytes are always moved out, so only
+    // a partial byte can be left behind
+    if( bufferBits != 0 ) {
         // Update temp
-        temp = 8 - numBits;
+        temp = 8 - bufferBits;
 
-        // Shift byte buffer
-        byte <<= temp;
+        // Low bits of accumulator are already zero
+        bufferBits += temp;
 
-        // Write buffer to file
-        output -> put( byte );
-
-        // Reset buffer
-        reset();
+        flushBits();
     }
 
     return temp;
 }
 
 /** 
- * readByte()
+ * flush()
  *
- * Reads the next eight bits in input file
- * and returns a character
+ * Pads the last byte and writes everything
+ * buffered to the output file
  */
-char BitIO::readSymbol() {
-    // Function variables
-    char bit, bits = 0;
-
-    // Loop through gathering 8 bits
-    for( int i = 0; i < 8; i++ ) {
-        // Read one bit
-        bit = readBit();
-
-        // Bit shift!
-        bits <<= 1;
+void BitIO::flush() {
+    pad();
+    drainBuffer();
+}
 
-        // Append new bit
-        bits |= bit;
+/** 
+ * drainBuffer()
+ *
+ * Writes buffered bytes to the output file. The byte
+ * at bufferPos may hold bits still in the accumulator,
+ * they are stored again by the next flushBits()
+ */
+void BitIO::drainBuffer() {
+    // Memory writers cannot drain, stay within the last word
+    if( output == NULL ) {
+        overflow  = true;
+        bufferPos = bufferSize - 8;
+        return;
     }
 
-    // Return 8 bits
-    return bits;
+    output -> write( (const char *) buffer, bufferPos );
+    bufferPos = 0;
 }
 
 /** 
@@ -188,31 +210,7 @@ char BitIO::readSymbol() {
  * and returns a character (0x00 or 0x01)
  */
 char BitIO::readBit() {
-    // Function variables
-             char bit = 0;
-    unsigned char mask = 1 << 7;
-
-    // If there are no bits in the buffer
-    // grab the next 8 bits (char)
-    if( !( input -> eof() ) && numBits == 0 ) {
-        input -> get( byte );
-        numBits = 8;
-    }
-
-    // If the most significant bit is a 1
-    // set it to the return variable
-    if( byte & mask ) {
-        bit |= 1;
-    }
-
-    // Bit shift!
-    byte <<= 1;
-
-    // Decrement number of bits in buffer
-    --numBits;
-
-    // Return 1 bit
-    return bit;
+    return (char) readBits( 1 );
 }
 
 /** 
@@ -220,27 +218,67 @@ char BitIO::readBit() {
  *
  * Reads next 8 bits in input file
  * and returns a character
- * Decrements file position pointer
+ * Bits are left in the accumulator
  */
 char BitIO::peek() {
-    // Store current file pointer position
-    int pos = input -> tellg();
+    return (char) peekBits( 8 );
+}
 
-    // Cache contents of buffer
-    char bufferCache = byte;
+/** 
+ * getBitsRead()
+ *
+ * Returns number of bits consumed since
+ * the reader was constructed
+ */
+unsigned long long BitIO::getBitsRead() {
+    return bitsRead;
+}
 
-    // Cache next 8 bits
-    char bits = readSymbol();
+/** 
+ * getBytesWritten()
+ *
+ * Returns number of whole bytes stored by
+ * a memory writer, call pad() first
+ */
+size_t BitIO::getBytesWritten() {
+    return bufferPos;
+}
+
+/** 
+ * hasOverflowed()
+ *
+ * Returns true if a memory writer was given
+ * too little room for its output
+ */
+bool BitIO::hasOverflowed() {
+    return overflow;
+}
+
+/** 
+ * fillBuffer()
+ *
+ * Moves unread bytes to the front of the buffer
+ * and reads the next chunk of the file after them
+ */
+void BitIO::fillBuffer() {
+    // Memory readers hold everything already
+    if( input == NULL ) {
+        return;
+    }
 
-    // If we needed to grab next 8 bits, rewind
-    if( pos < input -> tellg() ) {
-        // Rewind pointer
-        input -> unget();
+    // Function variables
+    size_t remaining = bufferEnd - bufferPos;
+
+    for( size_t i = 0; i < remaining; i++ ) {
+        buffer[i] = buffer[bufferPos + i];
     }
 
-    // Replace buffer with old contents
-    byte = bufferCache;
+    bufferPos = 0;
+    bufferEnd = remaining;
 
-    // Return character
-    return bits;
-}
\ No newline at end of file
+    // Read as much as fits, a short read means end of file
+    if( input -> good() ) {
+        input -> read( (char *) &buffer[remaining], bufferSize - remaining );
+        bufferEnd += input -> gcount();
+    }
+}
@@ -10,30 +10,268 @@
 // Include libraries
 #include <iostream>
 #include <fstream>
+#include <vector>
 
+// Hot paths of the coding loops must be inlined into them
+#if defined( __GNUC__ )
+#define FORCE_INLINE inline __attribute__(( always_inline ))
+#else
+#define FORCE_INLINE inline
+#endif
+
+/** 
+ * loadWord()
+ *
+ * Returns 8 bytes read big-endian, as one
+ * load and byte swap where the compiler allows
+ */
+FORCE_INLINE unsigned long long loadWord( const unsigned char *p ) {
+#if defined( __GNUC__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long word;
+    __builtin_memcpy( &word, p, sizeof( word ) );
+
+    return __builtin_bswap64( word );
+#else
+    unsigned long long word = 0;
+
+    for( int i = 0; i < 8; i++ ) {
+        word = ( word << 8 ) | p[i];
+    }
+
+    return word;
+#endif
+}
+
+/** 
+ * storeWord()
+ *
+ * Stores 8 bytes big-endian
+ */
+FORCE_INLINE void storeWord( unsigned char *p, unsigned long long word ) {
+#if defined( __GNUC__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64( word );
+    __builtin_memcpy( p, &word, sizeof( word ) );
+#else
+    for( int i = 0; i < 8; i++ ) {
+        p[i] = (unsigned char) ( word >> ( 56 - 8 * i ) );
+    }
+#endif
+}
+
+/** 
+ * BitIO
+ *
+ * Reads and writes bit fields through a 64-bit accumulator
+ * backed by a user-space byte buffer. The file stream is only
+ * touched when the whole buffer is refilled or drained.
+ * In memory mode the buffer is the caller's own memory
+ */
 class BitIO {
     public:
+        static const int    MAX_BITS    = 57;                       // Widest field read or written in one call
+        static const size_t BUFFER_SIZE = 1 << 20;                  // Bytes buffered between stream calls
+
         BitIO();                                                    // Default constructor
         BitIO( std::ifstream &input );                              // Reader object
         BitIO( std::ofstream &output );                             // Writer object
+        BitIO( const unsigned char *data, size_t size );            // Memory reader object
+        BitIO( unsigned char *data, size_t capacity );              // Memory writer object, needs 8 spare bytes
 
-        int  getNumBits();                                          // Returns number of bits currently in buffer
-        void reset();                                               // Resets buffer to zero
+        int  getNumBits();                                          // Returns number of bits currently in accumulator
+        void reset();                                               // Resets accumulator to zero
 
-        void writeSymbol( char character );                         // Writes a char to file
+        template<typename Symbol>
+        void writeSymbol( Symbol symbol );                          // Writes a symbol as its width in bits
         void writeBit( char bit );                                  // Writes a binary bit to file
+        void writeBits( unsigned long long bits, int n );           // Writes low n bits, most significant first
 
-        int  pad();                                                 // Checks if latest buffer needs padding
+        int  pad();                                                 // Pads accumulator to a whole byte
+        void flush();                                               // Pads and drains buffer to file
 
-        char readSymbol();                                          // Returns next 8 bits as char
+        template<typename Symbol>
+        Symbol readSymbol();                                        // Returns next symbol of its width
         char readBit();                                             // Returns next bit as char (0/1)
-        char peek();                                                // Returns next 8 bits and decremnts file pointer
+        char peek();                                                // Returns next 8 bits without consuming them
+
+        unsigned long long readBits( int n );                       // Returns next n bits
+        unsigned long long peekBits( int n );                       // Returns next n bits without consuming them
+        void               skipBits( int n );                       // Consumes n bits previously peeked
+        unsigned long long getBitsRead();                           // Returns number of bits consumed so far
+        size_t             getBytesWritten();                       // Returns bytes stored by a memory writer
+        bool               hasOverflowed();                         // Returns true if a memory writer ran out of room
 
     private:
-        char byte;                                                  // Buffer
-        int  numBits;                                               // Number of bits in buffer
+        void refill();                                              // Tops up the read accumulator
+        void fillBuffer();                                          // Reads next chunk of file into buffer
+        void drainBuffer();                                         // Writes buffered bytes to file
+        void flushBits();                                           // Moves whole bytes from accumulator to buffer
+
+        unsigned long long bitBuffer;                               // Accumulator, next bit is the MSB
+        int    bufferBits;                                          // Number of valid bits in accumulator
+        unsigned long long bitsRead;                                // Number of bits consumed by the reader
+
+        std::vector<unsigned char> storage;                         // Buffer storage owned in stream mode
+        unsigned char *buffer;                                      // User-space byte buffer
+        size_t bufferSize;                                          // Capacity of buffer
+        size_t bufferPos;                                           // Next byte to read or write in buffer
+        size_t bufferEnd;                                           // End of valid bytes in buffer (reader)
+        bool   overflow;                                            // Memory writer ran out of room
+
         std::ifstream *input;                                       // Input file stream
         std::ofstream *output;                                      // Output file stream
 };
 
-#endif
\ No newline at end of file
+/** 
+ * writeBits()
+ *
+ * Appends the low n bits of a value (n <= MAX_BITS) to the
+ * accumulator and moves completed bytes to the buffer.
+ * Bits above n must be zero. Defined here so the
+ * encode loop can inline it
+ */
+FORCE_INLINE void BitIO::writeBits( unsigned long long bits, int n ) {
+    if( n == 0 ) {
+        return;
+    }
+
+    // Place new bits directly below those already held
+    bitBuffer  |= bits << ( 64 - bufferBits - n );
+    bufferBits += n;
+
+    flushBits();
+}
+
+/** 
+ * flushBits()
+ *
+ * Stores the whole accumulator big-endian at the buffer
+ * position and advances by the number of complete bytes,
+ * leaving at most 7 bits behind
+ */
+FORCE_INLINE void BitIO::flushBits() {
+    storeWord( &buffer[bufferPos], bitBuffer );
+
+    int bytes = bufferBits >> 3;
+
+    // Two shifts so a full word never shifts by 64
+    bufferPos  += bytes;
+    bitBuffer   = ( bitBuffer << ( bytes * 4 ) ) << ( bytes * 4 );
+    bufferBits &= 7;
+
+    // Keep room for the next whole word store
+    if( bufferPos > bufferSize - 8 ) {
+        drainBuffer();
+    }
+}
+
+/** 
+ * refill()
+ *
+ * Tops up the accumulator with as many whole bytes as
+ * fit, leaving at least 57 valid bits. A whole word is
+ * loaded at once while 8 bytes remain in the buffer.
+ * Once the file is exhausted the accumulator is
+ * padded with zeros. Defined here so the decode
+ * loop can inline it
+ */
+FORCE_INLINE void BitIO::refill() {
+    // Fetch next chunk of file when buffer runs low
+    if( bufferEnd - bufferPos < 8 ) {
+        fillBuffer();
+    }
+
+    if( bufferEnd - bufferPos >= 8 ) {
+        // Load word big-endian
+        unsigned long long word = loadWord( &buffer[bufferPos] );
+
+        // Bits of a partial byte below the valid ones are
+        // the same bits the next load places there
+        int bytes = ( 64 - bufferBits ) >> 3;
+
+        bitBuffer  |= word >> bufferBits;
+        bufferPos  += bytes;
+        bufferBits += bytes * 8;
+    } else {
+        // Tail of file, byte at a time
+        while( bufferBits <= 56 ) {
+            unsigned long long c = 0;
+
+            if( bufferPos < bufferEnd ) {
+                c = buffer[bufferPos++];
+            }
+
+            bitBuffer  |= c << ( 56 - bufferBits );
+            bufferBits += 8;
+        }
+    }
+}
+
+/** 
+ * peekBits()
+ *
+ * Returns the next n bits (n <= MAX_BITS) right aligned
+ * without consuming them. Bits past the end of file are zero
+ */
+FORCE_INLINE unsigned long long BitIO::peekBits( int n ) {
+    // Make sure enough bits are buffered
+    if( bufferBits < n ) {
+        refill();
+    }
+
+    // Top n bits, split shift keeps n == 0 defined
+    return ( bitBuffer >> 1 ) >> ( 63 - n );
+}
+
+/** 
+ * skipBits()
+ *
+ * Consumes n bits from the accumulator
+ */
+FORCE_INLINE void BitIO::skipBits( int n ) {
+    // Make sure enough bits are buffered
+    if( bufferBits < n ) {
+        refill();
+    }
+
+    // Shift consumed bits out of the accumulator
+    bitBuffer  <<= n;
+    bufferBits  -= n;
+    bitsRead    += n;
+}
+
+/** 
+ * readBits()
+ *
+ * Reads the next n bits (n <= MAX_BITS) in the input
+ * file and returns them right aligned
+ */
+FORCE_INLINE unsigned long long BitIO::readBits( int n ) {
+    // Grab bits then consume them
+    unsigned long long bits = peekBits( n );
+    skipBits( n );
+
+    return bits;
+}
+
+/** 
+ * writeSymbol()
+ *
+ * Writes a symbol as all the bits of its type,
+ * 8 for a byte and 16 for a uint16_t
+ */
+template<typename Symbol>
+FORCE_INLINE void BitIO::writeSymbol( Symbol symbol ) {
+    writeBits( (unsigned long long) symbol & ( ( 1ULL << ( 8 * sizeof( Symbol ) ) ) - 1 ), 8 * sizeof( Symbol ) );
+}
+
+/** 
+ * readSymbol()
+ *
+ * Reads a symbol of the width of its type
+ */
+template<typename Symbol>
+FORCE_INLINE Symbol BitIO::readSymbol() {
+    return (Symbol) readBits( 8 * sizeof( Symbol ) );
+}
+
+#endif
@@ -0,0 +1,928 @@
+/** 
+ * BlockCodec.cc
+ *
+ * Class methods and implementation
+ * for coding independent blocks
+ */
+
+// Include header file
+#include "BlockCodec.hh"
+#include "TreeBuilder.hh"
+#include "Kernels.hh"
+
+// Include libraries
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+/** 
+ * lap()
+ *
+ * Returns seconds since mark and moves
+ * the mark on to now
+ */
+static double lap( std::chrono::steady_clock::time_point &mark ) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>( now - mark ).count();
+
+    mark = now;
+
+    return seconds;
+}
+
+/** 
+ * analyze()
+ *
+ * Counts the block's frequencies and builds its own
+ * code table, and measures what carrying that table
+ * and coding with it would cost. Workers analyze
+ * blocks in any order. Returns false if the
+ * codes could not be built
+ */
+bool BlockCodec::analyze( const unsigned char *src, size_t size, const BlockOptions &options,
+                          BlockPlan &plan, BlockStats &stats ) {
+    std::chrono::steady_clock::time_point mark = std::chrono::steady_clock::now();
+
+    clearStats( stats );
+
+    // Build codebook for this block
+    TreeBuilder<unsigned char> tree;
+    tree.setMaxCodeLength( options.maxCodeLength );
+    tree.countFrequencies( src, size );
+
+    stats.histogramSeconds = lap( mark );
+
+    if( !tree.build() ) {
+        return false;
+    }
+
+    plan.table     = tree.getCodeTable();
+    plan.codedBits = tree.getCodedBits();
+    plan.layout    = ( options.numStreams == NUM_STREAMS ) ? LAYOUT_STREAMS : LAYOUT_SINGLE;
+    plan.distance  = 0;
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        plan.frequencies[s] = tree.getFrequency( s );
+
+        if( plan.frequencies[s] > 0 ) {
+            stats.seen[s / 64] |= 1ULL << ( s % 64 );
+        }
+    }
+
+    // Size of own table, written once here to measure it
+    unsigned char scratch[CodeTable::MAX_HEADER_BYTES + 16];
+    BitIO         writer( scratch, sizeof( scratch ) );
+
+    if( !plan.table.write( writer ) ) {
+        return false;
+    }
+
+    plan.tableBits = writer.getBytesWritten() * 8 + writer.getNumBits();
+
+    stats.unlimitedBits = tree.getUnlimitedBits();
+    stats.numSymbols    = size;
+    stats.numBlocks     = 1;
+    stats.entropyBits   = tree.getEntropyBits();
+
+    // Context tables, written once here to measure them
+    plan.contextBits = 0;
+
+    if( options.contextModel ) {
+        std::vector<unsigned char> tables( ContextModel::MAX_TABLES * CodeTable::MAX_HEADER_BYTES + CodeTable::NUM_SYMBOLS );
+        BitIO                      contextWriter( tables.data(), tables.size() );
+
+        // A model that could not be built is left out of the choice
+        if( plan.context.build( src, size, options.maxCodeLength ) ) {
+            plan.context.write( contextWriter );
+            plan.contextBits = contextWriter.getBytesWritten() * 8 + contextWriter.getNumBits();
+        }
+    }
+
+    stats.treeSeconds = lap( mark );
+
+    return true;
+}
+
+/** 
+ * choose()
+ *
+ * Works out the exact payload of the block with its own
+ * table, with the table the chain last carried and with
+ * the shared table and, if asked for, with order-1 context
+ * tables, and keeps the smallest. Reusing wins
+ * ties, since the decoder then has no table to build.
+ * A block that no table shrinks is stored. Blocks must
+ * be chosen in order, as a block carrying its own table
+ * moves the chain on to it
+ */
+void BlockCodec::choose( BlockPlan &plan, size_t size, const BlockOptions &options, TableChain &chain ) {
+    // Function variables
+    int    streams = ( options.numStreams == NUM_STREAMS ) ? NUM_STREAMS : 1;
+    size_t packed  = payloadSize( streams, plan.tableBits, plan.codedBits );
+
+    if( options.sharedTable != NULL ) {
+        CodeTable         &shared     = options.sharedTable -> getCodeTable();
+        unsigned long long sharedBits = 0;
+
+        for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+            sharedBits += plan.frequencies[s] * shared.getLength( s );
+        }
+
+        if( payloadSize( 1, SharedTable::ID_SIZE * 8, sharedBits ) <= packed ) {
+            packed         = payloadSize( 1, SharedTable::ID_SIZE * 8, sharedBits );
+            plan.layout    = LAYOUT_SHARED;
+            plan.codedBits = sharedBits;
+        }
+    }
+
+    if( options.contextModel && plan.contextBits > 0 && payloadSize( 1, plan.contextBits, plan.context.getCodedBits() ) < packed ) {
+        packed         = payloadSize( 1, plan.contextBits, plan.context.getCodedBits() );
+        plan.layout    = LAYOUT_CONTEXT;
+        plan.codedBits = plan.context.getCodedBits();
+    }
+
+    // Earlier table only works if it has a code for every symbol
+    if( chain.valid ) {
+        unsigned char      distance[MAX_VARINT_SIZE];
+        unsigned long long reusedBits = 0;
+        bool               covered    = true;
+
+        for( int s = 0; s < CodeTable::NUM_SYMBOLS && covered; s++ ) {
+            if( plan.frequencies[s] > 0 ) {
+                covered     = chain.table.getLength( s ) > 0;
+                reusedBits += plan.frequencies[s] * chain.table.getLength( s );
+            }
+        }
+
+        size_t distanceBytes = putVarint( distance, chain.next - chain.block );
+
+        if( covered && payloadSize( streams, distanceBytes * 8, reusedBits ) <= packed ) {
+            packed         = payloadSize( streams, distanceBytes * 8, reusedBits );
+            plan.layout    = LAYOUT_REUSE;
+            plan.codedBits = reusedBits;
+            plan.distance  = chain.next - chain.block;
+            plan.table     = chain.table;
+        }
+    }
+
+    // Coding gains nothing, copy the block instead
+    if( packed >= 1 + size ) {
+        plan.layout    = LAYOUT_STORED;
+        plan.codedBits = 8ULL * size;
+    }
+
+    if( plan.layout == LAYOUT_SINGLE || plan.layout == LAYOUT_STREAMS ) {
+        chain.table = plan.table;
+        chain.valid = true;
+        chain.block = chain.next;
+    }
+
+    chain.next++;
+}
+
+/** 
+ * compress()
+ *
+ * Writes the layout byte and the block coded as planned.
+ * With its own table, a single stream follows the table
+ * directly and is padded to a whole byte. With four
+ * streams the table is padded, then a jump table gives
+ * the bytes of the first three streams and each stream
+ * is padded. A reusing block has the distance back to
+ * the table's block in place of the table. A shared
+ * table is named by ID, context tables are followed by
+ * one stream, and a stored block is copied.
+ * Sizes and the time of each phase go into stats
+ */
+bool BlockCodec::compress( const unsigned char *src, size_t size, const BlockPlan &plan,
+                           std::vector<unsigned char> &dst, const BlockOptions &options, BlockStats &stats ) {
+    std::chrono::steady_clock::time_point mark = std::chrono::steady_clock::now();
+
+    const KernelSet &kernels = Kernels::get();
+
+    stats.codedBits = plan.codedBits;
+
+    // Raw bytes are counted apart from codes
+    if( plan.layout == LAYOUT_STORED ) {
+        dst.resize( 1 + size );
+        dst[0] = LAYOUT_STORED;
+        memcpy( &dst[1], src, size );
+
+        stats.codedBits     = 0;
+        stats.unlimitedBits = 0;
+        stats.storedBytes   = size;
+        stats.numStored     = 1;
+        stats.headerSeconds = lap( mark );
+
+        return true;
+    }
+
+    // Room for layout, table, symbols and the writer's trailing word store
+    dst.resize( CodeTable::MAX_HEADER_BYTES + MAX_LAYOUT_BYTES + MAX_VARINT_SIZE + ( plan.contextBits + plan.codedBits ) / 8 + 16 );
+    dst[0] = plan.layout;
+
+    if( plan.layout == LAYOUT_CONTEXT ) {
+        ContextModel context = plan.context;
+        BitIO        stream( &dst[1], dst.size() - 1 );
+
+        context.write( stream );
+
+        stats.headerBits    = plan.contextBits;
+        stats.headerSeconds = lap( mark );
+
+        context.encode( src, size, stream );
+        stream.pad();
+
+        stats.encodeSeconds = lap( mark );
+
+        if( stream.hasOverflowed() ) {
+            return false;
+        }
+
+        dst.resize( 1 + stream.getBytesWritten() );
+
+        stats.unlimitedBits = plan.codedBits;
+        stats.maxLength     = context.getMaxLength();
+        stats.numContext    = 1;
+
+        return dst.size() <= packedBound( size );
+    }
+
+    if( plan.layout == LAYOUT_SHARED ) {
+        CodeTable &shared = options.sharedTable -> getCodeTable();
+
+        putWord( &dst[1], options.sharedTable -> getId() );
+
+        BitIO stream( &dst[1 + SharedTable::ID_SIZE], dst.size() - 1 - SharedTable::ID_SIZE );
+
+        stats.headerSeconds = lap( mark );
+
+        kernels.encode( src, size, 1, shared.getCodes(), shared.getLengths(), shared.getMaxLength(), stream );
+        stream.pad();
+
+        stats.encodeSeconds = lap( mark );
+
+        if( stream.hasOverflowed() ) {
+            return false;
+        }
+
+        dst.resize( 1 + SharedTable::ID_SIZE + stream.getBytesWritten() );
+
+        stats.unlimitedBits = plan.codedBits;
+        stats.headerBits    = SharedTable::ID_SIZE * 8;
+        stats.maxLength     = shared.getMaxLength();
+
+        return dst.size() <= packedBound( size );
+    }
+
+    // Own table, or distance back to the block carrying it
+    CodeTable                 table     = plan.table;
+    const int                *lengths   = table.getLengths();
+    const unsigned long long *words     = table.getCodes();
+    int                       maxLength = table.getMaxLength();
+    int                       streams   = ( options.numStreams == NUM_STREAMS ) ? NUM_STREAMS : 1;
+    size_t                    start     = 1;
+
+    stats.maxLength = maxLength;
+
+    if( plan.layout == LAYOUT_REUSE ) {
+        start += putVarint( &dst[1], plan.distance );
+
+        stats.unlimitedBits = plan.codedBits;
+        stats.numReused     = 1;
+    }
+
+    BitIO writer( &dst[start], dst.size() - start );
+
+    if( plan.layout != LAYOUT_REUSE ) {
+        table.write( writer );
+    }
+
+    stats.headerBits    = ( start - 1 ) * 8 + writer.getBytesWritten() * 8 + writer.getNumBits();
+    stats.headerSeconds = lap( mark );
+
+    if( streams == 1 ) {
+        kernels.encode( src, size, 1, words, lengths, maxLength, writer );
+
+        writer.pad();
+
+        if( writer.hasOverflowed() ) {
+            return false;
+        }
+
+        dst.resize( start + writer.getBytesWritten() );
+    } else {
+        writer.pad();
+
+        if( writer.hasOverflowed() ) {
+            return false;
+        }
+
+        // Streams start after the jump table. Each is written
+        // in turn, so a writer's trailing word store is covered
+        // by the stream after it
+        size_t jump = start + writer.getBytesWritten();
+        size_t pos  = jump + 4 * ( NUM_STREAMS - 1 );
+
+        for( int k = 0; k < NUM_STREAMS; k++ ) {
+            BitIO stream( &dst[pos], dst.size() - pos );
+
+            if( (size_t) k < size ) {
+                kernels.encode( src + k, ( size - k + NUM_STREAMS - 1 ) / NUM_STREAMS, NUM_STREAMS,
+                                words, lengths, maxLength, stream );
+            }
+
+            stream.pad();
+
+            if( stream.hasOverflowed() ) {
+                return false;
+            }
+
+            if( k < NUM_STREAMS - 1 ) {
+                putWord( &dst[jump + 4 * k], stream.getBytesWritten() );
+            }
+
+            pos += stream.getBytesWritten();
+        }
+
+        dst.resize( pos );
+    }
+
+    stats.encodeSeconds = lap( mark );
+
+    return dst.size() <= packedBound( size );
+}
+
+/** 
+ * decompress()
+ *
+ * Reads the block's layout and code table and decodes
+ * exactly rawSize symbols. Four streams are decoded in
+ * one interleaved loop so their lookups overlap. A block
+ * naming a shared table needs that table to be given,
+ * and a stored block is copied as it is. A reusing block
+ * needs the payload of the block whose table it reuses,
+ * or at least its layout and table, in reused.
+ * Returns false if the payload is malformed or too short
+ */
+bool BlockCodec::decompress( const unsigned char *src, size_t size, unsigned char *dst, size_t rawSize,
+                             SharedTable *sharedTable, const unsigned char *reused, size_t reusedSize ) {
+    if( size == 0 || src[0] > LAYOUT_CONTEXT ) {
+        return false;
+    }
+
+    // Context tables are read and built for each block
+    if( src[0] == LAYOUT_CONTEXT ) {
+        static thread_local ContextModel context;
+        BitIO                            reader( src + 1, size - 1 );
+
+        return context.read( reader ) && context.decode( reader, size - 1, dst, rawSize );
+    }
+
+    if( src[0] == LAYOUT_STORED ) {
+        if( size != 1 + rawSize ) {
+            return false;
+        }
+
+        memcpy( dst, src + 1, rawSize );
+
+        return true;
+    }
+
+    // Shared table is built once, nothing to read
+    if( src[0] == LAYOUT_SHARED ) {
+        if( sharedTable == NULL || size < 1 + SharedTable::ID_SIZE || getWord( src + 1 ) != sharedTable -> getId() ) {
+            return false;
+        }
+
+        BitIO reader( src + 1 + SharedTable::ID_SIZE, size - 1 - SharedTable::ID_SIZE );
+
+        return decodeSingle( sharedTable -> getDecodeTable(), reader, size - 1 - SharedTable::ID_SIZE, dst, rawSize );
+    }
+
+    // Table is carried by this block or by the one reused
+    const unsigned char *carrier     = src;
+    size_t               carrierSize = size;
+    size_t               start       = 1;
+
+    if( src[0] == LAYOUT_REUSE ) {
+        unsigned long long distance;
+        size_t             n = getVarint( src + 1, size - 1, distance );
+
+        if( n == 0 || reused == NULL || reusedSize < 2 || reused[0] > LAYOUT_STREAMS ) {
+            return false;
+        }
+
+        carrier     = reused;
+        carrierSize = reusedSize;
+        start      += n;
+    }
+
+    // Each thread keeps its table from block to block, with the
+    // carrier it was read from and that carrier's table bytes
+    static thread_local DecodeTable          decoder;
+    static thread_local int                  built[CodeTable::NUM_SYMBOLS];
+    static thread_local bool                 ready = false;
+    static thread_local const unsigned char *builtFrom     = NULL;
+    static thread_local size_t               builtFromSize = 0;
+    static thread_local size_t               builtBytes    = 0;
+    static thread_local unsigned char        builtHeader[CodeTable::MAX_HEADER_BYTES];
+
+    BitIO reader( carrier + 1, carrierSize - 1 );
+
+    // A reused table whose carrier was the last one read is neither
+    // read nor built again. Its bytes are compared too, in case
+    // another buffer has since been mapped at the same address
+    bool current = src[0] == LAYOUT_REUSE && ready && carrier == builtFrom && carrierSize == builtFromSize &&
+                   memcmp( builtHeader, carrier + 1, builtBytes ) == 0;
+
+    if( !current ) {
+        CodeTable table;
+
+        if( !table.read( reader ) ) {
+            return false;
+        }
+
+        // Own tables are only rebuilt when the code lengths change
+        if( !ready || memcmp( built, table.getLengths(), sizeof( built ) ) != 0 ) {
+            decoder.build( table.getLengths(), table.getCodes(), CodeTable::NUM_SYMBOLS );
+            memcpy( built, table.getLengths(), sizeof( built ) );
+            ready = true;
+        }
+
+        builtFrom     = carrier;
+        builtFromSize = carrierSize;
+        builtBytes    = std::min( (size_t) ( reader.getBitsRead() + 7 ) / 8, carrierSize - 1 );
+
+        memcpy( builtHeader, carrier + 1, builtBytes );
+    }
+
+    // Own single stream follows the table without padding
+    if( src[0] == LAYOUT_SINGLE ) {
+        return decodeSingle( decoder, reader, size - 1, dst, rawSize );
+    }
+
+    if( carrier[0] == LAYOUT_SINGLE ) {
+        BitIO stream( src + start, size - start );
+
+        return decodeSingle( decoder, stream, size - start, dst, rawSize );
+    }
+
+    // Jump table follows the padded table, or the distance
+    size_t jump = ( src[0] == LAYOUT_STREAMS ) ? 1 + ( reader.getBitsRead() + 7 ) / 8 : start;
+
+    // Locate streams through the jump table
+    size_t pos = jump + 4 * ( NUM_STREAMS - 1 );
+    size_t lengths[NUM_STREAMS];
+
+    if( pos > size ) {
+        return false;
+    }
+
+    for( int k = 0; k < NUM_STREAMS - 1; k++ ) {
+        lengths[k] = getWord( src + jump + 4 * k );
+
+        if( lengths[k] > size - pos ) {
+            return false;
+        }
+
+        pos += lengths[k];
+    }
+
+    lengths[NUM_STREAMS - 1] = size - pos;
+    pos = jump + 4 * ( NUM_STREAMS - 1 );
+
+    BitIO r0( src + pos, lengths[0] );
+    pos += lengths[0];
+    BitIO r1( src + pos, lengths[1] );
+    pos += lengths[1];
+    BitIO r2( src + pos, lengths[2] );
+    pos += lengths[2];
+    BitIO r3( src + pos, lengths[3] );
+
+    // Four independent dependency chains per iteration. Symbols
+    // go through a local batch, since stores through dst could
+    // alias the readers and force their state back to memory
+    size_t        i = 0;
+    unsigned char batch[BATCH_SIZE];
+
+    for( ; i + BATCH_SIZE <= rawSize; i += BATCH_SIZE ) {
+        for( size_t j = 0; j < BATCH_SIZE; j += NUM_STREAMS ) {
+            batch[j]     = (unsigned char) decoder.decodeSymbol( r0 );
+            batch[j + 1] = (unsigned char) decoder.decodeSymbol( r1 );
+            batch[j + 2] = (unsigned char) decoder.decodeSymbol( r2 );
+            batch[j + 3] = (unsigned char) decoder.decodeSymbol( r3 );
+        }
+
+        memcpy( dst + i, batch, BATCH_SIZE );
+    }
+
+    BitIO *tail[NUM_STREAMS] = { &r0, &r1, &r2, &r3 };
+
+    for( ; i < rawSize; i++ ) {
+        dst[i] = (unsigned char) decoder.decodeSymbol( *tail[i % NUM_STREAMS] );
+    }
+
+    return r0.getBitsRead() <= (unsigned long long) lengths[0] * 8 &&
+           r1.getBitsRead() <= (unsigned long long) lengths[1] * 8 &&
+           r2.getBitsRead() <= (unsigned long long) lengths[2] * 8 &&
+           r3.getBitsRead() <= (unsigned long long) lengths[3] * 8;
+}
+
+/** 
+ * decodeSingle()
+ *
+ * Decodes rawSize symbols from one bitstream through
+ * a local batch. Returns false if the symbols ran
+ * past the size bytes the reader was given
+ */
+bool BlockCodec::decodeSingle( DecodeTable &decoder, BitIO &reader, size_t size, unsigned char *dst, size_t rawSize ) {
+    size_t        i = 0;
+    unsigned char batch[BATCH_SIZE];
+
+    for( ; i + BATCH_SIZE <= rawSize; i += BATCH_SIZE ) {
+        for( size_t j = 0; j < BATCH_SIZE; j++ ) {
+            batch[j] = (unsigned char) decoder.decodeSymbol( reader );
+        }
+
+        memcpy( dst + i, batch, BATCH_SIZE );
+    }
+
+    for( ; i < rawSize; i++ ) {
+        dst[i] = (unsigned char) decoder.decodeSymbol( reader );
+    }
+
+    // Reader pads with zeros past the end, which is only valid in the last byte
+    return reader.getBitsRead() <= (unsigned long long) size * 8;
+}
+
+/** 
+ * decodeBlock()
+ *
+ * Decodes the payload of one block of an index into
+ * dst. A reusing block names the block carrying its
+ * table by distance, which must lie earlier in the index
+ */
+bool BlockCodec::decodeBlock( const unsigned char *file, const std::vector<BlockEntry> &index, size_t block,
+                              unsigned char *dst, SharedTable *sharedTable ) {
+    // Function variables
+    const unsigned char *payload, *reused = NULL;
+    size_t               size, reusedSize = 0;
+
+    if( !locatePayload( file, index[block], payload, size ) ) {
+        return false;
+    }
+
+    if( size > 0 && payload[0] == LAYOUT_REUSE ) {
+        unsigned long long distance;
+
+        if( getVarint( payload + 1, size - 1, distance ) == 0 || distance == 0 || distance > block ||
+            !locatePayload( file, index[block - distance], reused, reusedSize ) ) {
+            return false;
+        }
+    }
+
+    return decompress( payload, size, dst, index[block].rawSize, sharedTable, reused, reusedSize );
+}
+
+/** 
+ * locatePayload()
+ *
+ * Parses the block header an index entry points at and
+ * checks it agrees with the entry. Returns false if not
+ */
+bool BlockCodec::locatePayload( const unsigned char *file, const BlockEntry &entry,
+                                const unsigned char *&payload, size_t &size ) {
+    // Function variables
+    const unsigned char *p = file + entry.fileOffset;
+    unsigned long long   rawSize, packedSize;
+    size_t               used, n;
+
+    // Block header
+    used = getVarint( p, entry.length, rawSize );
+
+    if( used == 0 ) {
+        return false;
+    }
+
+    n = getVarint( p + used, entry.length - used, packedSize );
+
+    if( n == 0 || rawSize != entry.rawSize || packedSize > entry.length ||
+        used + n + packedSize != entry.length ) {
+        return false;
+    }
+
+    payload = p + used + n;
+    size    = packedSize;
+
+    return true;
+}
+
+/** 
+ * packedBound()
+ *
+ * Returns an upper bound on the payload of a block.
+ * A Huffman code never averages more than the 8 bits
+ * of a plain byte, so the payload is at most the raw
+ * size plus the code table, layout byte, jump table
+ * and a padding byte per stream
+ */
+size_t BlockCodec::packedBound( size_t rawSize ) {
+    return CodeTable::MAX_HEADER_BYTES + MAX_LAYOUT_BYTES + rawSize;
+}
+
+/** 
+ * payloadSize()
+ *
+ * Returns bytes of a payload holding the layout byte,
+ * headerBits of table or distance and codedBits of
+ * symbols. Exact for one stream; with four the padding
+ * of each stream is counted at its worst
+ */
+size_t BlockCodec::payloadSize( int streams, unsigned long long headerBits, unsigned long long codedBits ) {
+    if( streams == 1 ) {
+        return 1 + ( headerBits + codedBits + 7 ) / 8;
+    }
+
+    return 1 + ( headerBits + 7 ) / 8 + 4 * ( NUM_STREAMS - 1 ) + ( codedBits + 7 * NUM_STREAMS ) / 8;
+}
+
+/** 
+ * clearStats()
+ *
+ * Zeroes every count and timing
+ */
+void BlockCodec::clearStats( BlockStats &stats ) {
+    stats.codedBits     = 0;
+    stats.unlimitedBits = 0;
+    stats.storedBytes   = 0;
+    stats.headerBits    = 0;
+    stats.numSymbols    = 0;
+    stats.numBlocks     = 0;
+    stats.numStored     = 0;
+    stats.numReused     = 0;
+    stats.numContext    = 0;
+    stats.entropyBits   = 0;
+    stats.maxLength     = 0;
+
+    for( size_t i = 0; i < sizeof( stats.seen ) / sizeof( stats.seen[0] ); i++ ) {
+        stats.seen[i] = 0;
+    }
+
+    stats.histogramSeconds = 0;
+    stats.treeSeconds      = 0;
+    stats.headerSeconds    = 0;
+    stats.encodeSeconds    = 0;
+    stats.flushSeconds     = 0;
+}
+
+/** 
+ * addStats()
+ *
+ * Adds a block's sizes and timings to totals,
+ * keeping the longest code and every symbol seen
+ */
+void BlockCodec::addStats( BlockStats &totals, const BlockStats &stats ) {
+    totals.codedBits     += stats.codedBits;
+    totals.unlimitedBits += stats.unlimitedBits;
+    totals.storedBytes   += stats.storedBytes;
+    totals.headerBits    += stats.headerBits;
+    totals.numSymbols    += stats.numSymbols;
+    totals.numBlocks     += stats.numBlocks;
+    totals.numStored     += stats.numStored;
+    totals.numReused     += stats.numReused;
+    totals.numContext    += stats.numContext;
+    totals.entropyBits   += stats.entropyBits;
+    totals.maxLength      = std::max( totals.maxLength, stats.maxLength );
+
+    for( size_t i = 0; i < sizeof( stats.seen ) / sizeof( stats.seen[0] ); i++ ) {
+        totals.seen[i] |= stats.seen[i];
+    }
+
+    totals.histogramSeconds += stats.histogramSeconds;
+    totals.treeSeconds      += stats.treeSeconds;
+    totals.headerSeconds    += stats.headerSeconds;
+    totals.encodeSeconds    += stats.encodeSeconds;
+    totals.flushSeconds     += stats.flushSeconds;
+}
+
+/** 
+ * countSeen()
+ *
+ * Returns number of distinct symbols coded
+ */
+int BlockCodec::countSeen( const BlockStats &stats ) {
+    int count = 0;
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        count += ( stats.seen[s / 64] >> ( s % 64 ) ) & 1;
+    }
+
+    return count;
+}
+
+/** 
+ * writeFileHeader()
+ *
+ * Writes magic, version and block size.
+ * Returns number of bytes written
+ */
+size_t BlockCodec::writeFileHeader( unsigned char *p, size_t blockSize ) {
+    p[0] = 'H';
+    p[1] = 'U';
+    p[2] = 'F';
+    p[3] = VERSION;
+
+    return MAGIC_SIZE + putVarint( p + MAGIC_SIZE, blockSize );
+}
+
+/** 
+ * checkMagic()
+ *
+ * Returns false if this is not a container
+ * this version can read
+ */
+bool BlockCodec::checkMagic( const unsigned char *p ) {
+    return p[0] == 'H' && p[1] == 'U' && p[2] == 'F' && p[3] == VERSION;
+}
+
+/** 
+ * writeIndex()
+ *
+ * Appends the block index and footer
+ */
+void BlockCodec::writeIndex( std::vector<unsigned char> &out, const std::vector<BlockEntry> &index ) {
+    // Function variables
+    unsigned char field[MAX_VARINT_SIZE];
+    size_t        start = out.size();
+
+    out.insert( out.end(), field, field + putVarint( field, index.size() ) );
+
+    for( size_t i = 0; i < index.size(); i++ ) {
+        out.insert( out.end(), field, field + putVarint( field, index[i].rawSize ) );
+        out.insert( out.end(), field, field + putVarint( field, index[i].length ) );
+    }
+
+    // Footer
+    unsigned char footer[FOOTER_SIZE] = { 0, 0, 0, 0, 'I', 'D', 'X', VERSION };
+
+    putWord( footer, out.size() - start );
+
+    out.insert( out.end(), footer, footer + FOOTER_SIZE );
+}
+
+/** 
+ * readIndex()
+ *
+ * Reads the index through the footer at the end of the
+ * file and works out where every block starts. Returns
+ * false unless the blocks, end marker and index exactly
+ * cover the file
+ */
+bool BlockCodec::readIndex( const unsigned char *file, size_t size, std::vector<BlockEntry> &index ) {
+    // Function variables
+    unsigned long long blockSize, numBlocks, value;
+    size_t             used;
+
+    index.clear();
+
+    // File header
+    if( size < MAGIC_SIZE + FOOTER_SIZE || !checkMagic( file ) ) {
+        return false;
+    }
+
+    used = getVarint( file + MAGIC_SIZE, size - MAGIC_SIZE, blockSize );
+
+    if( used == 0 ) {
+        return false;
+    }
+
+    unsigned long long offset = MAGIC_SIZE + used;
+
+    // Footer
+    const unsigned char *footer = file + size - FOOTER_SIZE;
+
+    if( footer[4] != 'I' || footer[5] != 'D' || footer[6] != 'X' || footer[7] != VERSION ) {
+        return false;
+    }
+
+    unsigned long long indexSize = getWord( footer );
+
+    // The header varint may run into the footer of a tiny file
+    if( offset + FOOTER_SIZE > size || indexSize > size - FOOTER_SIZE - offset ) {
+        return false;
+    }
+
+    const unsigned char *p   = footer - indexSize;
+    const unsigned char *end = footer;
+
+    // Block count
+    used = getVarint( p, end - p, numBlocks );
+
+    if( used == 0 || numBlocks > indexSize ) {
+        return false;
+    }
+
+    p += used;
+
+    // Raw size and length of each block
+    unsigned long long rawOffset = 0;
+
+    for( unsigned long long i = 0; i < numBlocks; i++ ) {
+        BlockEntry entry;
+
+        used = getVarint( p, end - p, value );
+
+        if( used == 0 || value == 0 || value > blockSize ) {
+            return false;
+        }
+
+        p              += used;
+        entry.rawSize   = value;
+        entry.rawOffset = rawOffset;
+
+        used = getVarint( p, end - p, value );
+
+        if( used == 0 || value > size ) {
+            return false;
+        }
+
+        p                += used;
+        entry.length      = value;
+        entry.fileOffset  = offset;
+
+        rawOffset += entry.rawSize;
+        offset    += entry.length;
+
+        index.push_back( entry );
+    }
+
+    // Blocks are followed by the end marker, then the index
+    return p == end && offset + 1 + indexSize + FOOTER_SIZE == size && file[offset] == 0;
+}
+
+/** 
+ * putVarint()
+ *
+ * Stores a value seven bits at a time, lowest
+ * first. Returns number of bytes written
+ */
+size_t BlockCodec::putVarint( unsigned char *p, unsigned long long value ) {
+    size_t n = 0;
+
+    while( value >= 0x80 ) {
+        p[n++]   = (unsigned char) ( value | 0x80 );
+        value  >>= 7;
+    }
+
+    p[n++] = (unsigned char) value;
+
+    return n;
+}
+
+/** 
+ * getVarint()
+ *
+ * Loads a value stored by putVarint() from at most
+ * size bytes. Returns number of bytes read, or zero
+ * if the value is truncated or too long
+ */
+size_t BlockCodec::getVarint( const unsigned char *p, size_t size, unsigned long long &value ) {
+    value = 0;
+
+    for( size_t n = 0; n < size && n < MAX_VARINT_SIZE; n++ ) {
+        value |= (unsigned long long) ( p[n] & 0x7f ) << ( 7 * n );
+
+        if( ( p[n] & 0x80 ) == 0 ) {
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+/** 
+ * putWord()
+ *
+ * Stores a 32-bit value little-endian
+ */
+void BlockCodec::putWord( unsigned char *p, unsigned int value ) {
+    for( int i = 0; i < 4; i++ ) {
+        p[i] = (unsigned char) ( value >> ( 8 * i ) );
+    }
+}
+
+/** 
+ * getWord()
+ *
+ * Loads a 32-bit little-endian value
+ */
+unsigned int BlockCodec::getWord( const unsigned char *p ) {
+    unsigned int value = 0;
+
+    for( int i = 3; i >= 0; i-- ) {
+        value = ( value << 8 ) | p[i];
+    }
+
+    return value;
+}
@@ -0,0 +1,201 @@
+/** 
+ * BlockCodec.hh
+ *
+ * Class definitions
+ */
+
+#ifndef BLOCKCODEC_HH
+#define BLOCKCODEC_HH
+
+// Include libraries
+#include <iostream>
+#include <vector>
+
+// Include classes
+#include "BitIO.hh"
+#include "CodeTable.hh"
+#include "DecodeTable.hh"
+#include "SharedTable.hh"
+#include "ContextModel.hh"
+
+/** 
+ * BlockEntry
+ *
+ * Position of one block in the raw data and in the file
+ */
+struct BlockEntry {
+    unsigned long long rawOffset;                                   // Offset of first raw byte
+    unsigned long long rawSize;                                     // Number of raw bytes
+    unsigned long long fileOffset;                                  // Offset of block header in file
+    unsigned long long length;                                      // Bytes of block header and payload
+};
+
+/** 
+ * BlockOptions
+ *
+ * Settings applied when compressing a block
+ */
+struct BlockOptions {
+    int maxCodeLength;                                              // Longest code allowed, 0 for no limit
+    int numStreams;                                                 // Interleaved bitstreams, 1 or NUM_STREAMS
+    SharedTable *sharedTable;                                       // Table a block may name instead, or NULL
+    bool contextModel;                                              // Also try order-1 context tables
+};
+
+/** 
+ * BlockPlan
+ *
+ * What a block's frequencies are and which table
+ * it was chosen to be coded with
+ */
+struct BlockPlan {
+    unsigned long long frequencies[CodeTable::NUM_SYMBOLS];         // Count of each symbol in the block
+    CodeTable          table;                                       // Own codes, or the codes being reused
+    unsigned long long tableBits;                                   // Bits of own table once written
+    unsigned long long codedBits;                                   // Bits of symbols with table
+    unsigned char      layout;                                      // Payload layout chosen
+    unsigned long long distance;                                    // Blocks back to the table being reused
+    ContextModel       context;                                     // Order-1 tables, built if options ask
+    unsigned long long contextBits;                                 // Bits of context map and tables, 0 if not built
+};
+
+/** 
+ * TableChain
+ *
+ * Most recent code table carried by a block,
+ * followed while planning blocks in order
+ */
+struct TableChain {
+    CodeTable          table;                                       // Codes carried
+    bool               valid;                                       // False until a block carries a table
+    unsigned long long block;                                       // Number of block carrying them
+    unsigned long long next;                                        // Number of next block to plan
+};
+
+/** 
+ * BlockStats
+ *
+ * Sizes and timings recorded while compressing a block,
+ * or summed over the blocks of a file
+ */
+struct BlockStats {
+    unsigned long long codedBits;                                   // Bits of coded symbols, stored blocks left out
+    unsigned long long unlimitedBits;                               // Bits the symbols would take without a limit
+    unsigned long long storedBytes;                                 // Raw bytes of stored blocks
+    unsigned long long headerBits;                                  // Bits of code tables or table IDs
+    unsigned long long numSymbols;                                  // Symbols coded
+    unsigned long long numBlocks;                                   // Blocks coded
+    unsigned long long numStored;                                   // Blocks stored uncoded
+    unsigned long long numReused;                                   // Blocks coded with an earlier block's table
+    unsigned long long numContext;                                  // Blocks coded with order-1 context tables
+    unsigned long long seen[CodeTable::NUM_SYMBOLS / 64];           // Bit set for every distinct symbol
+    double             entropyBits;                                 // Least bits any code could give the blocks
+    int                maxLength;                                   // Longest code used
+    double             histogramSeconds;                            // Counting frequencies
+    double             treeSeconds;                                 // Building and limiting codes
+    double             headerSeconds;                               // Writing code tables
+    double             encodeSeconds;                               // Packing codes into streams
+    double             flushSeconds;                                // Writing output, set by the caller
+};
+
+/** 
+ * BlockCodec
+ *
+ * Layout of the block container and compression of a
+ * single block. Every block carries its own code table,
+ * so blocks can be coded independently of each other.
+ *
+ *   file header   "HUF", version, block size
+ *   block         raw size, packed size, payload
+ *   payload       layout, code table, then one bitstream, or a
+ *                 jump table of three stream sizes and four bitstreams,
+ *                 or the ID of a shared table and one bitstream,
+ *                 or the distance back to the block whose table
+ *                 is reused and its bitstreams,
+ *                 or order-1 context tables and one bitstream,
+ *                 or the raw bytes when coding would not shrink them
+ *   end marker    raw size of zero
+ *   index         block count, then raw size and length of each block
+ *   footer        index length (4 bytes, little-endian), "IDX", version
+ *
+ * Sizes are variable length integers, seven bits per
+ * byte with the high bit set on all but the last byte.
+ * Four streams take symbols round-robin so one thread can
+ * decode them in an interleaved loop.
+ * Each block is coded with whichever of its own table, the
+ * table last carried by an earlier block, a shared table,
+ * context tables or no coding at all makes it smallest.
+ * The index lets a reader find every block from the end
+ * of the file without scanning through them
+ */
+class BlockCodec {
+    public:
+        static const int    VERSION            = 3;                 // Container version written
+        static const size_t MAGIC_SIZE         = 4;                 // Bytes of magic and version
+        static const size_t MAX_VARINT_SIZE    = 10;                // Longest variable length integer
+        static const size_t MAX_FILE_HEADER_SIZE  = MAGIC_SIZE + MAX_VARINT_SIZE;
+        static const size_t MAX_BLOCK_HEADER_SIZE = 2 * MAX_VARINT_SIZE;
+        static const size_t FOOTER_SIZE        = 8;                 // Bytes of index length and footer magic
+        static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;           // Raw bytes per block unless configured
+        static const size_t MIN_BLOCK_SIZE     = 1 << 10;           // Smallest block size accepted
+        static const size_t MAX_BLOCK_SIZE     = 1 << 28;           // Largest block size accepted
+        static const int    NUM_STREAMS        = 4;                 // Bitstreams in an interleaved block
+        static const size_t MAX_LAYOUT_BYTES   = 1 + 4 * ( NUM_STREAMS - 1 ) + NUM_STREAMS;
+        static const size_t BATCH_SIZE         = 64;                // Symbols decoded between stores to output
+
+        static const unsigned char LAYOUT_SINGLE  = 0;              // Payload holds one bitstream
+        static const unsigned char LAYOUT_STREAMS = 1;              // Payload holds NUM_STREAMS bitstreams
+        static const unsigned char LAYOUT_SHARED  = 2;              // Payload names a shared table, one bitstream
+        static const unsigned char LAYOUT_STORED  = 3;              // Payload holds the raw bytes
+        static const unsigned char LAYOUT_REUSE   = 4;              // Payload uses an earlier block's table
+        static const unsigned char LAYOUT_CONTEXT = 5;              // Payload holds order-1 context tables
+
+        static bool analyze( const unsigned char *src, size_t size,           // Counts a block and builds its codes
+                             const BlockOptions &options, BlockPlan &plan, BlockStats &stats );
+        static void choose( BlockPlan &plan, size_t size,                     // Picks the cheapest table, in block order
+                            const BlockOptions &options, TableChain &chain );
+
+        static bool compress( const unsigned char *src, size_t size,          // Codes one planned block into payload
+                              const BlockPlan &plan, std::vector<unsigned char> &dst,
+                              const BlockOptions &options, BlockStats &stats );
+        static bool decompress( const unsigned char *src, size_t size,        // Decodes one payload into rawSize bytes
+                                unsigned char *dst, size_t rawSize,
+                                SharedTable *sharedTable,
+                                const unsigned char *reused, size_t reusedSize );
+
+        static bool decodeBlock( const unsigned char *file,                   // Decodes the block an index entry points at
+                                 const std::vector<BlockEntry> &index, size_t block,
+                                 unsigned char *dst, SharedTable *sharedTable );
+        static bool locatePayload( const unsigned char *file,                 // Finds the payload an entry points at
+                                   const BlockEntry &entry,
+                                   const unsigned char *&payload, size_t &size );
+
+        static bool decodeSingle( DecodeTable &decoder, BitIO &reader,        // Decodes rawSize symbols of one stream
+                                  size_t size, unsigned char *dst, size_t rawSize );
+
+        static size_t packedBound( size_t rawSize );                          // Largest payload of a block
+        static size_t payloadSize( int streams, unsigned long long headerBits,  // Payload of coded symbols and padding
+                                   unsigned long long codedBits );
+
+        static void clearStats( BlockStats &stats );                          // Zeroes every count and timing
+        static void addStats( BlockStats &totals, const BlockStats &stats );  // Adds a block's stats to totals
+        static int  countSeen( const BlockStats &stats );                     // Returns number of distinct symbols
+
+        static size_t writeFileHeader( unsigned char *p, size_t blockSize );  // Returns bytes written
+        static bool   checkMagic( const unsigned char *p );                   // Checks magic and version
+
+        static void writeIndex( std::vector<unsigned char> &out,              // Appends index and footer
+                                const std::vector<BlockEntry> &index );
+        static bool readIndex( const unsigned char *file, size_t size,        // Locates every block from the footer
+                               std::vector<BlockEntry> &index );
+
+        static size_t putVarint( unsigned char *p,                            // Returns bytes written
+                                 unsigned long long value );
+        static size_t getVarint( const unsigned char *p, size_t size,         // Returns bytes read, 0 if malformed
+                                 unsigned long long &value );
+
+        static void         putWord( unsigned char *p, unsigned int value );  // Stores 32-bit little-endian value
+        static unsigned int getWord( const unsigned char *p );                // Loads 32-bit little-endian value
+};
+
+#endif
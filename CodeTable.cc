@@ -0,0 +1,305 @@
+/** 
+ * CodeTable.cc
+ *
+ * Class methods and implementation
+ * for canonical prefix codes
+ */
+
+// Include header file
+#include "CodeTable.hh"
+
+// Include libraries
+#include <algorithm>
+
+/** 
+ * BasicCodeTable()
+ *
+ * Default constructor
+ */
+template<typename Symbol>
+BasicCodeTable<Symbol>::BasicCodeTable() : lengths( NUM_SYMBOLS, 0 ), codes( NUM_SYMBOLS, 0 ) {
+}
+
+/** 
+ * clear()
+ *
+ * Marks every symbol as absent
+ */
+template<typename Symbol>
+void BasicCodeTable<Symbol>::clear() {
+    std::fill( lengths.begin(), lengths.end(), 0 );
+    std::fill( codes.begin(), codes.end(), 0 );
+}
+
+/** 
+ * setLength()
+ *
+ * Sets code length of a symbol
+ */
+template<typename Symbol>
+void BasicCodeTable<Symbol>::setLength( int symbol, int length ) {
+    lengths[symbol] = length;
+}
+
+/** 
+ * getLength()
+ *
+ * Returns code length of a symbol
+ */
+template<typename Symbol>
+int BasicCodeTable<Symbol>::getLength( int symbol ) {
+    return lengths[symbol];
+}
+
+/** 
+ * getCode()
+ *
+ * Returns code word of a symbol
+ */
+template<typename Symbol>
+unsigned long long BasicCodeTable<Symbol>::getCode( int symbol ) {
+    return codes[symbol];
+}
+
+/** 
+ * getNumSymbols()
+ *
+ * Returns number of symbols with a code
+ */
+template<typename Symbol>
+int BasicCodeTable<Symbol>::getNumSymbols() {
+    int count = 0;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( lengths[s] > 0 ) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/** 
+ * getMaxLength()
+ *
+ * Returns length of longest code
+ */
+template<typename Symbol>
+int BasicCodeTable<Symbol>::getMaxLength() {
+    int maxLength = 0;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( lengths[s] > maxLength ) {
+            maxLength = lengths[s];
+        }
+    }
+
+    return maxLength;
+}
+
+/** 
+ * getLengths()
+ *
+ * Returns array of code lengths
+ */
+template<typename Symbol>
+const int* BasicCodeTable<Symbol>::getLengths() {
+    return lengths.data();
+}
+
+/** 
+ * getCodes()
+ *
+ * Returns array of code words
+ */
+template<typename Symbol>
+const unsigned long long* BasicCodeTable<Symbol>::getCodes() {
+    return codes.data();
+}
+
+/** 
+ * assignCanonicalCodes()
+ *
+ * Assigns code words so that shorter codes come first
+ * and codes of equal length follow symbol order.
+ * Returns false if the lengths cannot form a prefix code
+ */
+template<typename Symbol>
+bool BasicCodeTable<Symbol>::assignCanonicalCodes() {
+    // Function variables
+    unsigned long long count[MAX_CODE_LENGTH + 1] = { 0 };
+    unsigned long long next[MAX_CODE_LENGTH + 1]  = { 0 };
+    unsigned long long code = 0, left = 1;
+    int                numSymbols = 0;
+
+    // Count number of codes of each length
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( lengths[s] < 0 || lengths[s] > MAX_CODE_LENGTH ) {
+            return false;
+        }
+
+        if( lengths[s] > 0 ) {
+            count[lengths[s]]++;
+            numSymbols++;
+        }
+    }
+
+    // Check the code is neither over nor under subscribed.
+    // A lone symbol is allowed a one bit code
+    for( int len = 1; len <= MAX_CODE_LENGTH; len++ ) {
+        left <<= 1;
+
+        if( count[len] > left ) {
+            return false;
+        }
+
+        left -= count[len];
+    }
+
+    if( left != 0 && !( numSymbols == 1 && count[1] == 1 ) ) {
+        return false;
+    }
+
+    // First code of each length
+    for( int len = 1; len <= MAX_CODE_LENGTH; len++ ) {
+        code      = ( code + count[len - 1] ) << 1;
+        next[len] = code;
+    }
+
+    // Hand out consecutive codes in symbol order
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( lengths[s] > 0 ) {
+            codes[s] = next[lengths[s]]++;
+        }
+    }
+
+    return true;
+}
+
+/** 
+ * write()
+ *
+ * Writes number of symbols and the width of a code
+ * length, then every symbol in use as the gap from the
+ * previous one followed by its code length. An
+ * empty table cannot be stored, nothing is written
+ * and false is returned
+ */
+template<typename Symbol>
+bool BasicCodeTable<Symbol>::write( BitIO &writer ) {
+    int numSymbols = getNumSymbols();
+    int maxLength  = getMaxLength();
+
+    if( numSymbols == 0 ) {
+        return false;
+    }
+
+    // Number of symbols less one, so a full alphabet fits a symbol
+    writer.writeBits( numSymbols - 1, SYMBOL_BITS );
+
+    // Lengths only take as many bits as the longest one needs
+    int width = 1;
+
+    while( ( maxLength >> width ) != 0 ) {
+        width++;
+    }
+
+    writer.writeBits( width, WIDTH_BITS );
+
+    int previous = -1;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( lengths[s] == 0 ) {
+            continue;
+        }
+
+        writeGap( writer, s - previous );
+        writer.writeBits( lengths[s], width );
+
+        previous = s;
+    }
+
+    return true;
+}
+
+/** 
+ * read()
+ *
+ * Reads code lengths written by write() and derives
+ * the canonical code words. Returns false on a
+ * malformed header
+ */
+template<typename Symbol>
+bool BasicCodeTable<Symbol>::read( BitIO &reader ) {
+    // Start from an empty table
+    clear();
+
+    int numSymbols = (int) reader.readBits( SYMBOL_BITS ) + 1;
+    int width      = (int) reader.readBits( WIDTH_BITS );
+    int previous   = -1;
+
+    if( width < 1 || width > LENGTH_BITS ) {
+        return false;
+    }
+
+    for( int i = 0; i < numSymbols; i++ ) {
+        int s = previous + readGap( reader );
+
+        // Gaps always move forward through the alphabet
+        if( s <= previous || s >= NUM_SYMBOLS ) {
+            return false;
+        }
+
+        lengths[s] = (int) reader.readBits( width );
+
+        if( lengths[s] == 0 ) {
+            return false;
+        }
+
+        previous = s;
+    }
+
+    return assignCanonicalCodes();
+}
+
+/** 
+ * writeGap()
+ *
+ * Writes a gap between symbols as an Elias gamma code,
+ * so neighbouring symbols cost a single bit
+ */
+template<typename Symbol>
+void BasicCodeTable<Symbol>::writeGap( BitIO &writer, int gap ) {
+    int n = 0;
+
+    while( ( gap >> ( n + 1 ) ) != 0 ) {
+        n++;
+    }
+
+    // n zeros announce an n + 1 bit value
+    writer.writeBits( 0, n );
+    writer.writeBits( gap, n + 1 );
+}
+
+/** 
+ * readGap()
+ *
+ * Reads a gap written by writeGap()
+ */
+template<typename Symbol>
+int BasicCodeTable<Symbol>::readGap( BitIO &reader ) {
+    int n = 0;
+
+    // Count leading zeros, a gap never exceeds the alphabet
+    while( reader.readBit() == 0 ) {
+        if( ( 1 << ++n ) > NUM_SYMBOLS ) {
+            return 0;
+        }
+    }
+
+    return (int) ( ( 1u << n ) | reader.readBits( n ) );
+}
+
+// Widths the library is built for
+template class BasicCodeTable<unsigned char>;
+template class BasicCodeTable<uint16_t>;
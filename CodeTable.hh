@@ -0,0 +1,80 @@
+/** 
+ * CodeTable.hh
+ *
+ * Class definitions
+ */
+
+#ifndef CODETABLE_HH
+#define CODETABLE_HH
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdint.h>
+
+// Include classes
+#include "BitIO.hh"
+
+/** 
+ * BasicCodeTable
+ *
+ * Code length and canonical code word of every symbol.
+ * Only the lengths are stored in the file header, the
+ * code words are derived from them on both sides. The
+ * alphabet is every value of Symbol, unsigned char for
+ * bytes or uint16_t for wide text and token IDs. The
+ * entries live on the heap, so a 16-bit table is as
+ * safe on the stack as a byte one
+ */
+template<typename Symbol>
+class BasicCodeTable {
+    public:
+        static const int SYMBOL_BITS     = 8 * sizeof( Symbol );    // Bits of one symbol
+        static const int NUM_SYMBOLS     = 1 << SYMBOL_BITS;        // Size of alphabet
+        static const int LENGTH_BITS     = 6;                       // Widest code length field in the header
+        static const int WIDTH_BITS      = 3;                       // Bits used to store that field width
+        static const int MAX_CODE_LENGTH = 57;                      // Longest code that may be stored
+        static const int MAX_HEADER_BYTES = 4 * NUM_SYMBOLS;        // Upper bound on bytes written by write()
+
+        BasicCodeTable();                                           // Default constructor: no symbols
+
+        void clear();                                               // Removes all symbols
+        void setLength( int symbol, int length );                   // Sets code length of a symbol
+        int  getLength( int symbol );                               // Returns code length of a symbol
+        unsigned long long getCode( int symbol );                   // Returns code word of a symbol
+
+        int  getNumSymbols();                                       // Returns number of symbols in use
+        int  getMaxLength();                                        // Returns longest code length
+
+        const int*                getLengths();                     // Returns code lengths indexed by symbol
+        const unsigned long long* getCodes();                       // Returns code words indexed by symbol
+
+        bool assignCanonicalCodes();                                // Derives code words from lengths
+
+        bool write( BitIO &writer );                                // Writes code lengths to file header
+        bool read( BitIO &reader );                                 // Reads code lengths from file header
+
+    private:
+        void writeGap( BitIO &writer, int gap );                    // Writes distance to previous symbol
+        int  readGap( BitIO &reader );                              // Reads distance to previous symbol
+
+        std::vector<int>                lengths;                    // Code length, zero if symbol is absent
+        std::vector<unsigned long long> codes;                      // Canonical code word
+};
+
+template<typename Symbol> const int BasicCodeTable<Symbol>::SYMBOL_BITS;
+template<typename Symbol> const int BasicCodeTable<Symbol>::NUM_SYMBOLS;
+template<typename Symbol> const int BasicCodeTable<Symbol>::LENGTH_BITS;
+template<typename Symbol> const int BasicCodeTable<Symbol>::WIDTH_BITS;
+template<typename Symbol> const int BasicCodeTable<Symbol>::MAX_CODE_LENGTH;
+template<typename Symbol> const int BasicCodeTable<Symbol>::MAX_HEADER_BYTES;
+
+// Byte alphabet used by the block container
+typedef BasicCodeTable<unsigned char> CodeTable;
+
+// Methods are compiled in CodeTable.cc for these widths
+extern template class BasicCodeTable<unsigned char>;
+extern template class BasicCodeTable<uint16_t>;
+
+#endif
@@ -0,0 +1,536 @@
+/** 
+ * Codec.cc
+ *
+ * Class methods and implementation
+ * for coding containers in memory
+ */
+
+// Include header file
+#include "Codec.hh"
+#include "ThreadPool.hh"
+#include "Kernels.hh"
+
+// Include libraries
+#include <memory>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+/** 
+ * defaults()
+ *
+ * Returns options for a single threaded call with
+ * the default block size, no limit and no shared table
+ */
+CodecOptions Codec::defaults() {
+    CodecOptions options;
+
+    options.blockSize     = BlockCodec::DEFAULT_BLOCK_SIZE;
+    options.numThreads    = 1;
+    options.maxCodeLength = 0;
+    options.numStreams    = 1;
+    options.sharedTable   = NULL;
+    options.contextModel  = false;
+
+    return options;
+}
+
+/** 
+ * compressBound()
+ *
+ * Returns largest possible container: header, every
+ * block at its bound, end marker and an index of
+ * maximum width
+ */
+size_t Codec::compressBound( size_t srcSize, size_t blockSize ) {
+    size_t numBlocks = ( srcSize + blockSize - 1 ) / blockSize;
+
+    return BlockCodec::MAX_FILE_HEADER_SIZE + 1
+         + numBlocks * ( BlockCodec::MAX_BLOCK_HEADER_SIZE + BlockCodec::packedBound( blockSize ) )
+         + ( 2 * numBlocks + 1 ) * BlockCodec::MAX_VARINT_SIZE + BlockCodec::FOOTER_SIZE;
+}
+
+/** 
+ * compress()
+ *
+ * Codes src as a container of blocks into dst. Blocks
+ * are compressed on worker threads when more than one
+ * is asked for and copied out in input order. Adds the
+ * sizes of every block to stats if given
+ */
+CodecStatus Codec::compress( const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity,
+                             size_t &dstSize, const CodecOptions &options, BlockStats *stats ) {
+    // Function variables
+    std::deque<BlockJob *>     pending;
+    std::vector<BlockEntry>    index;
+    std::vector<unsigned char> trailer;
+    BlockOptions               blockOptions;
+    BlockStats                 totals;
+    CodecStatus                status = CODEC_OK;
+    size_t                     blockSize = options.blockSize;
+    size_t                     outPos;
+
+    dstSize = 0;
+    BlockCodec::clearStats( totals );
+
+    if( blockSize < BlockCodec::MIN_BLOCK_SIZE ) {
+        blockSize = BlockCodec::MIN_BLOCK_SIZE;
+    } else if( blockSize > BlockCodec::MAX_BLOCK_SIZE ) {
+        blockSize = BlockCodec::MAX_BLOCK_SIZE;
+    }
+
+    if( dstCapacity < BlockCodec::MAX_FILE_HEADER_SIZE ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    blockOptions.maxCodeLength = options.maxCodeLength;
+    blockOptions.numStreams    = options.numStreams;
+    blockOptions.sharedTable   = options.sharedTable;
+    blockOptions.contextModel  = options.contextModel;
+    outPos = BlockCodec::writeFileHeader( dst, blockSize );
+
+    Kernels::prepare( srcSize );
+
+    // Workers analyze blocks, this thread picks their tables in order,
+    // then workers compress them while this thread copies them out.
+    // A bounded number of blocks are in each stage to cap memory use
+    {
+        int                         threads     = ( options.numThreads > 1 ) ? options.numThreads : 0;
+        std::unique_ptr<ThreadPool> pool( ( threads > 0 ) ? new ThreadPool( threads ) : NULL );
+        size_t                      maxInFlight = ( threads > 0 ) ? 2 * threads : 1;
+        std::deque<BlockJob *>      analyzing;
+        TableChain                  chain;
+
+        chain.valid = false;
+        chain.block = 0;
+        chain.next  = 0;
+
+        for( size_t offset = 0; offset < srcSize; offset += blockSize ) {
+            BlockJob *job  = new BlockJob();
+            bool      last = ( offset + blockSize >= srcSize );
+
+            // Block is a slice of the caller's buffer
+            job -> src     = src + offset;
+            job -> srcSize = ( srcSize - offset < blockSize ) ? srcSize - offset : blockSize;
+            job -> rawSize = job -> srcSize;
+
+            if( threads > 0 ) {
+                job -> done = pool -> submit( [job, blockOptions]() {
+                    job -> ok = BlockCodec::analyze( job -> src, job -> srcSize, blockOptions, job -> plan, job -> stats );
+                } );
+            } else {
+                job -> ok = BlockCodec::analyze( job -> src, job -> srcSize, blockOptions, job -> plan, job -> stats );
+            }
+
+            analyzing.push_back( job );
+
+            // Pick tables in order, the oldest once too many are analyzing
+            while( !analyzing.empty() && ( analyzing.size() >= maxInFlight || last ) ) {
+                job = analyzing.front();
+                analyzing.pop_front();
+
+                // A block that could not be analyzed fails when it is written
+                if( !chooseBlock( job, blockOptions, chain ) ) {
+                    pending.push_back( job );
+                    continue;
+                }
+
+                if( threads > 0 ) {
+                    job -> done = pool -> submit( [job, blockOptions]() {
+                        job -> ok = BlockCodec::compress( job -> src, job -> srcSize, job -> plan, job -> result,
+                                                          blockOptions, job -> stats );
+                    } );
+                } else {
+                    job -> ok = BlockCodec::compress( job -> src, job -> srcSize, job -> plan, job -> result,
+                                                      blockOptions, job -> stats );
+                }
+
+                pending.push_back( job );
+            }
+
+            // Write blocks in order, the oldest once too many are in flight
+            while( !pending.empty() && ( pending.size() >= maxInFlight || last ) ) {
+                job = pending.front();
+                pending.pop_front();
+
+                if( status == CODEC_OK && !finishBlock( job, index, totals ) ) {
+                    status = CODEC_FAILED;
+                }
+
+                if( status == CODEC_OK && dstCapacity - outPos < job -> headerSize + job -> result.size() ) {
+                    status = CODEC_DST_TOO_SMALL;
+                }
+
+                if( status == CODEC_OK ) {
+                    std::copy( job -> header, job -> header + job -> headerSize, dst + outPos );
+                    outPos += job -> headerSize;
+
+                    std::copy( job -> result.begin(), job -> result.end(), dst + outPos );
+                    outPos += job -> result.size();
+                } else if( job -> done.valid() ) {
+                    job -> done.wait();
+                }
+
+                delete job;
+            }
+
+            // Let blocks still in flight finish before giving up
+            if( status != CODEC_OK ) {
+                pending.insert( pending.end(), analyzing.begin(), analyzing.end() );
+
+                for( size_t i = 0; i < pending.size(); i++ ) {
+                    if( pending[i] -> done.valid() ) {
+                        pending[i] -> done.wait();
+                    }
+
+                    delete pending[i];
+                }
+
+                return status;
+            }
+        }
+    }
+
+    // End marker, then index of blocks for parallel decoding
+    trailer.push_back( 0 );
+    BlockCodec::writeIndex( trailer, index );
+
+    if( dstCapacity - outPos < trailer.size() ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    std::copy( trailer.begin(), trailer.end(), dst + outPos );
+    outPos += trailer.size();
+
+    if( stats != NULL ) {
+        BlockCodec::addStats( *stats, totals );
+    }
+
+    dstSize = outPos;
+
+    return CODEC_OK;
+}
+
+/** 
+ * decompressedSize()
+ *
+ * Reads the raw size of a container from its index
+ */
+CodecStatus Codec::decompressedSize( const uint8_t *src, size_t srcSize, unsigned long long &rawSize ) {
+    std::vector<BlockEntry> index;
+
+    rawSize = 0;
+
+    if( !BlockCodec::readIndex( src, srcSize, index ) ) {
+        return CODEC_CORRUPT;
+    }
+
+    if( !index.empty() ) {
+        rawSize = index.back().rawOffset + index.back().rawSize;
+    }
+
+    return CODEC_OK;
+}
+
+/** 
+ * decompress()
+ *
+ * Decodes a container into dst. The index gives every
+ * block's place in the output, so blocks are decoded
+ * concurrently straight into their own slice
+ */
+CodecStatus Codec::decompress( const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity,
+                               size_t &dstSize, const CodecOptions &options ) {
+    return decompressRange( src, srcSize, 0, ~0ULL, dst, dstCapacity, dstSize, options );
+}
+
+/** 
+ * decompressRange()
+ *
+ * Decodes length bytes of the original data from offset
+ * start into dst, cut short at the end of the data. The
+ * index is searched for the blocks covering the range
+ * and only those are decoded, concurrently. Blocks wholly
+ * inside the range go straight into place, the partly
+ * covered ones at either end through a buffer of their own
+ */
+CodecStatus Codec::decompressRange( const uint8_t *src, size_t srcSize, unsigned long long start,
+                                    unsigned long long length, uint8_t *dst, size_t dstCapacity,
+                                    size_t &dstSize, const CodecOptions &options ) {
+    // Function variables
+    std::vector<BlockEntry>          index;
+    std::vector< std::future<void> > done;
+    unsigned long long               rawSize = 0;
+    std::atomic<bool>                ok( true );
+
+    dstSize = 0;
+
+    // Locate blocks
+    if( !BlockCodec::readIndex( src, srcSize, index ) ) {
+        return CODEC_CORRUPT;
+    }
+
+    if( !index.empty() ) {
+        rawSize = index.back().rawOffset + index.back().rawSize;
+    }
+
+    if( start > rawSize ) {
+        return CODEC_OUT_OF_RANGE;
+    }
+
+    length = std::min( length, rawSize - start );
+
+    if( length > dstCapacity ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    if( length == 0 ) {
+        return CODEC_OK;
+    }
+
+    // First block holding start, then every block up to the end
+    size_t first = std::upper_bound( index.begin(), index.end(), start, []( unsigned long long offset, const BlockEntry &entry ) {
+        return offset < entry.rawOffset;
+    } ) - index.begin() - 1;
+
+    std::unique_ptr<ThreadPool> pool( ( options.numThreads > 1 ) ? new ThreadPool( options.numThreads ) : NULL );
+
+    for( size_t i = first; i < index.size() && index[i].rawOffset < start + length && ok; i++ ) {
+        std::function<void()> task = [i, src, dst, start, length, &index, &options, &ok]() {
+            if( !decodeSlice( src, index, i, start, start + length, dst, options ) ) {
+                ok = false;
+            }
+        };
+
+        if( pool ) {
+            done.push_back( pool -> submit( task ) );
+        } else {
+            task();
+        }
+    }
+
+    for( size_t i = 0; i < done.size(); i++ ) {
+        done[i].wait();
+    }
+
+    if( !ok ) {
+        return CODEC_CORRUPT;
+    }
+
+    dstSize = length;
+
+    return CODEC_OK;
+}
+
+/** 
+ * messageBound()
+ *
+ * Returns largest message for srcSize bytes, every
+ * byte at the table's longest code, with the spare
+ * word the writer needs
+ */
+size_t Codec::messageBound( size_t srcSize, SharedTable &table ) {
+    return SharedTable::ID_SIZE + BlockCodec::MAX_VARINT_SIZE
+         + ( srcSize * table.getCodeTable().getMaxLength() + 7 ) / 8 + 8;
+}
+
+/** 
+ * compressMessage()
+ *
+ * Codes src with a shared table as a message: the
+ * table ID, the raw size and the coded bytes, with
+ * no table, container or index around them
+ */
+CodecStatus Codec::compressMessage( const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity,
+                                    size_t &dstSize, SharedTable &table ) {
+    // Function variables
+    CodeTable &codes = table.getCodeTable();
+    size_t     used  = SharedTable::ID_SIZE;
+
+    dstSize = 0;
+
+    if( !table.isReady() ) {
+        return CODEC_FAILED;
+    }
+
+    if( dstCapacity < SharedTable::ID_SIZE + BlockCodec::MAX_VARINT_SIZE ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    BlockCodec::putWord( dst, table.getId() );
+    used += BlockCodec::putVarint( dst + used, srcSize );
+
+    BitIO writer( dst + used, dstCapacity - used );
+
+    Kernels::get().encode( src, srcSize, 1, codes.getCodes(), codes.getLengths(), codes.getMaxLength(), writer );
+    writer.pad();
+
+    if( writer.hasOverflowed() ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    dstSize = used + writer.getBytesWritten();
+
+    return CODEC_OK;
+}
+
+/** 
+ * messageInfo()
+ *
+ * Reads the table ID and raw size of a message,
+ * so a caller holding several tables can pick one
+ */
+CodecStatus Codec::messageInfo( const uint8_t *src, size_t srcSize, unsigned int &tableId, unsigned long long &rawSize ) {
+    tableId = 0;
+    rawSize = 0;
+
+    if( srcSize < SharedTable::ID_SIZE ||
+        BlockCodec::getVarint( src + SharedTable::ID_SIZE, srcSize - SharedTable::ID_SIZE, rawSize ) == 0 ) {
+        return CODEC_CORRUPT;
+    }
+
+    tableId = BlockCodec::getWord( src );
+
+    return CODEC_OK;
+}
+
+/** 
+ * decompressMessage()
+ *
+ * Decodes a message written by compressMessage()
+ * with the same shared table
+ */
+CodecStatus Codec::decompressMessage( const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity,
+                                      size_t &dstSize, SharedTable &table ) {
+    // Function variables
+    unsigned int       tableId;
+    unsigned long long rawSize;
+    CodecStatus        status = messageInfo( src, srcSize, tableId, rawSize );
+    size_t             used;
+
+    dstSize = 0;
+
+    if( status != CODEC_OK ) {
+        return status;
+    }
+
+    if( !table.isReady() || tableId != table.getId() ) {
+        return CODEC_WRONG_TABLE;
+    }
+
+    if( rawSize > dstCapacity ) {
+        return CODEC_DST_TOO_SMALL;
+    }
+
+    used = SharedTable::ID_SIZE + BlockCodec::getVarint( src + SharedTable::ID_SIZE, srcSize - SharedTable::ID_SIZE, rawSize );
+
+    BitIO reader( src + used, srcSize - used );
+
+    if( !BlockCodec::decodeSingle( table.getDecodeTable(), reader, srcSize - used, dst, rawSize ) ) {
+        return CODEC_CORRUPT;
+    }
+
+    dstSize = rawSize;
+
+    return CODEC_OK;
+}
+
+/** 
+ * describe()
+ *
+ * Returns a message for a status
+ */
+const char *Codec::describe( CodecStatus status ) {
+    switch( status ) {
+        case CODEC_OK:            return "ok";
+        case CODEC_DST_TOO_SMALL: return "output buffer too small";
+        case CODEC_CORRUPT:       return "not a valid encoded container";
+        case CODEC_FAILED:        return "block could not be compressed";
+        case CODEC_WRONG_TABLE:   return "coded with a different shared table";
+        case CODEC_OUT_OF_RANGE:  return "range starts past the end of the data";
+    }
+
+    return "unknown status";
+}
+
+/** 
+ * decodeSlice()
+ *
+ * Decodes the part of a block between the raw offsets
+ * start and end into dst, which holds offset start
+ */
+bool Codec::decodeSlice( const uint8_t *src, const std::vector<BlockEntry> &index, size_t block,
+                         unsigned long long start, unsigned long long end, uint8_t *dst,
+                         const CodecOptions &options ) {
+    // Function variables
+    const BlockEntry  &entry = index[block];
+    unsigned long long from  = std::max( start, entry.rawOffset );
+    unsigned long long to    = std::min( end, entry.rawOffset + entry.rawSize );
+
+    if( from == entry.rawOffset && to == entry.rawOffset + entry.rawSize ) {
+        return BlockCodec::decodeBlock( src, index, block, dst + ( entry.rawOffset - start ), options.sharedTable );
+    }
+
+    std::vector<uint8_t> buffer( entry.rawSize );
+
+    if( !BlockCodec::decodeBlock( src, index, block, buffer.data(), options.sharedTable ) ) {
+        return false;
+    }
+
+    std::copy( buffer.begin() + ( from - entry.rawOffset ), buffer.begin() + ( to - entry.rawOffset ), dst + ( from - start ) );
+
+    return true;
+}
+
+/** 
+ * chooseBlock()
+ *
+ * Waits for a block to be analyzed and picks its
+ * table. Blocks must come here in order. Returns
+ * false if the block could not be analyzed
+ */
+bool Codec::chooseBlock( BlockJob *job, const BlockOptions &options, TableChain &chain ) {
+    if( job -> done.valid() ) {
+        job -> done.wait();
+    }
+
+    if( !job -> ok ) {
+        return false;
+    }
+
+    BlockCodec::choose( job -> plan, job -> srcSize, options, chain );
+
+    return true;
+}
+
+/** 
+ * finishBlock()
+ *
+ * Waits for a block to be compressed, fills in its
+ * header, records it in the index and adds its sizes
+ * to totals. Returns false if the block failed
+ */
+bool Codec::finishBlock( BlockJob *job, std::vector<BlockEntry> &index, BlockStats &totals ) {
+    if( job -> done.valid() ) {
+        job -> done.wait();
+    }
+
+    if( !job -> ok ) {
+        return false;
+    }
+
+    BlockCodec::addStats( totals, job -> stats );
+
+    job -> headerSize  = BlockCodec::putVarint( job -> header, job -> rawSize );
+    job -> headerSize += BlockCodec::putVarint( job -> header + job -> headerSize, job -> result.size() );
+
+    // Index only needs sizes, offsets follow from them
+    BlockEntry entry;
+    entry.rawSize = job -> rawSize;
+    entry.length  = job -> headerSize + job -> result.size();
+
+    index.push_back( entry );
+
+    return true;
+}
@@ -0,0 +1,132 @@
+/** 
+ * Codec.hh
+ *
+ * Class definitions
+ */
+
+#ifndef CODEC_HH
+#define CODEC_HH
+
+// Include libraries
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include <future>
+
+// Include classes
+#include "BlockCodec.hh"
+
+/** 
+ * BlockJob
+ *
+ * A block handed to a worker, either raw bytes
+ * to compress or a payload to decompress
+ */
+struct BlockJob {
+    const unsigned char       *src;                                 // Bytes to code
+    size_t                     srcSize;                             // Number of bytes to code
+    std::vector<unsigned char> owned;                               // Holds src when read from a stream
+    std::vector<unsigned char> result;                              // Coded or decoded bytes
+    size_t                     rawSize;                             // Raw bytes in block
+    unsigned char              header[BlockCodec::MAX_BLOCK_HEADER_SIZE]; // Block header once compressed
+    size_t                     headerSize;                          // Bytes in header
+    bool                       ok;                                  // Set by worker on success
+    BlockPlan                  plan;                                // Table chosen for the block
+    std::vector<unsigned char> reused;                              // Layout and table of the block reused
+    BlockStats                 stats;                               // Sizes recorded by compress
+    std::future<void>          done;                                // Ready once worker finished
+};
+
+/** 
+ * CodecStatus
+ *
+ * Outcome of a buffer call
+ */
+enum CodecStatus {
+    CODEC_OK = 0,                                                   // Done, output size is valid
+    CODEC_DST_TOO_SMALL,                                            // Output did not fit in capacity
+    CODEC_CORRUPT,                                                  // Input is not a valid container
+    CODEC_FAILED,                                                   // A block could not be compressed
+    CODEC_WRONG_TABLE,                                              // Coded with a shared table not given
+    CODEC_OUT_OF_RANGE                                              // Range starts past the end of the data
+};
+
+/** 
+ * CodecOptions
+ *
+ * Settings for a buffer call, see defaults()
+ */
+struct CodecOptions {
+    size_t blockSize;                                               // Raw bytes per block
+    int    numThreads;                                              // Worker threads, 1 codes on the calling thread
+    int    maxCodeLength;                                           // Longest code allowed, 0 for no limit
+    int    numStreams;                                              // Bitstreams per block, 1 or 4
+    SharedTable *sharedTable;                                       // Pre-trained table blocks may name, or NULL
+    bool   contextModel;                                            // Also try order-1 context tables per block
+};
+
+/** 
+ * Codec
+ *
+ * Compresses and decompresses whole containers between
+ * caller buffers. Nothing here touches the filesystem,
+ * prints or exits; every failure is a returned status,
+ * so the codec can be embedded in a long running service.
+ *
+ * Messages are for payloads too small to carry a table or
+ * a container. They are coded with a shared table only:
+ *
+ *   message       table ID (4 bytes, little-endian), raw size,
+ *                 one bitstream padded to a whole byte
+ */
+class Codec {
+    public:
+        static CodecOptions defaults();                                       // One thread, 1 MiB blocks, no limit or table
+
+        static size_t compressBound( size_t srcSize,                          // Largest container for srcSize bytes
+                                     size_t blockSize = BlockCodec::DEFAULT_BLOCK_SIZE );
+
+        static CodecStatus compress( const uint8_t *src, size_t srcSize,      // Codes src into a container in dst
+                                     uint8_t *dst, size_t dstCapacity, size_t &dstSize,
+                                     const CodecOptions &options, BlockStats *stats = NULL );
+
+        static CodecStatus decompressedSize( const uint8_t *src,              // Raw size recorded in a container
+                                             size_t srcSize, unsigned long long &rawSize );
+
+        static CodecStatus decompress( const uint8_t *src, size_t srcSize,    // Decodes a container into dst
+                                       uint8_t *dst, size_t dstCapacity, size_t &dstSize,
+                                       const CodecOptions &options );
+
+        static CodecStatus decompressRange( const uint8_t *src, size_t srcSize,   // Decodes length bytes from offset start
+                                            unsigned long long start, unsigned long long length,
+                                            uint8_t *dst, size_t dstCapacity, size_t &dstSize,
+                                            const CodecOptions &options );
+
+        static size_t messageBound( size_t srcSize, SharedTable &table );     // Largest message for srcSize bytes
+
+        static CodecStatus compressMessage( const uint8_t *src, size_t srcSize,   // Codes src as a message in dst
+                                            uint8_t *dst, size_t dstCapacity, size_t &dstSize,
+                                            SharedTable &table );
+
+        static CodecStatus messageInfo( const uint8_t *src, size_t srcSize,   // Table ID and raw size of a message
+                                        unsigned int &tableId, unsigned long long &rawSize );
+
+        static CodecStatus decompressMessage( const uint8_t *src, size_t srcSize, // Decodes a message into dst
+                                              uint8_t *dst, size_t dstCapacity, size_t &dstSize,
+                                              SharedTable &table );
+
+        static const char *describe( CodecStatus status );                    // Returns message for a status
+
+        static bool chooseBlock( BlockJob *job,                               // Waits for a block's analysis, picks its table
+                                 const BlockOptions &options, TableChain &chain );
+        static bool finishBlock( BlockJob *job,                               // Waits for a block and fills in its header
+                                 std::vector<BlockEntry> &index, BlockStats &totals );
+
+    private:
+        static bool decodeSlice( const uint8_t *src,                          // Decodes the part of a block in a range
+                                 const std::vector<BlockEntry> &index, size_t block,
+                                 unsigned long long start, unsigned long long end,
+                                 uint8_t *dst, const CodecOptions &options );
+};
+
+#endif
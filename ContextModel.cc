@@ -0,0 +1,310 @@
+/** 
+ * ContextModel.cc
+ *
+ * Class methods and implementation
+ * for order-1 context tables
+ */
+
+// Include header file
+#include "ContextModel.hh"
+#include "TreeBuilder.hh"
+
+// Include libraries
+#include <cmath>
+#include <algorithm>
+
+/** 
+ * ContextModel()
+ *
+ * Default constructor
+ */
+ContextModel::ContextModel() {
+    numTables = 1;
+    codedBits = 0;
+
+    for( int c = 0; c < CodeTable::NUM_SYMBOLS; c++ ) {
+        tableOf[c] = 0;
+    }
+}
+
+/** 
+ * build()
+ *
+ * Counts each symbol under its previous byte, clusters
+ * the contexts and builds a code table from the counts
+ * of each cluster. A context is moved to the cluster
+ * whose symbol costs, taken from the cluster's counts
+ * plus a half, give it the fewest bits, for up to
+ * ITERATIONS rounds or until none moves. Unused
+ * contexts go to the first table.
+ * Returns false if a table could not be built
+ */
+bool ContextModel::build( const unsigned char *src, size_t size, int maxCodeLength ) {
+    // Function variables
+    const int                       n = CodeTable::NUM_SYMBOLS;
+    std::vector<double>             costs( MAX_TABLES * n );
+    unsigned long long              totals[CodeTable::NUM_SYMBOLS] = { 0 };
+    unsigned long long              merged[MAX_TABLES][CodeTable::NUM_SYMBOLS];
+    int                             contexts[CodeTable::NUM_SYMBOLS];
+    int                             used     = 0;
+    int                             previous = 0;
+
+    // Counts by context, kept by each worker from block to block
+    static thread_local std::vector<unsigned long long> counts( n * n );
+
+    std::fill( counts.begin(), counts.end(), 0ULL );
+
+    for( size_t i = 0; i < size; i++ ) {
+        counts[previous * n + src[i]]++;
+        previous = src[i];
+    }
+
+    for( int c = 0; c < n; c++ ) {
+        for( int s = 0; s < n; s++ ) {
+            totals[c] += counts[c * n + s];
+        }
+
+        tableOf[c] = 0;
+
+        if( totals[c] > 0 ) {
+            contexts[used++] = c;
+        }
+    }
+
+    // Busiest contexts seed the clusters
+    std::sort( contexts, contexts + used, [&totals]( int a, int b ) {
+        return totals[a] > totals[b] || ( totals[a] == totals[b] && a < b );
+    } );
+
+    numTables = std::max( 1, std::min( used, (int) MAX_TABLES ) );
+
+    for( int i = 0; i < used; i++ ) {
+        tableOf[contexts[i]] = ( i < numTables ) ? i : 0;
+    }
+
+    for( int round = 0; round < ITERATIONS; round++ ) {
+        bool moved = false;
+
+        // Cost of each symbol in each cluster
+        for( int t = 0; t < numTables; t++ ) {
+            std::fill( merged[t], merged[t] + n, 0ULL );
+        }
+
+        for( int i = 0; i < used; i++ ) {
+            int c = contexts[i];
+
+            for( int s = 0; s < n; s++ ) {
+                merged[tableOf[c]][s] += counts[c * n + s];
+            }
+        }
+
+        for( int t = 0; t < numTables; t++ ) {
+            unsigned long long sum = 0;
+
+            for( int s = 0; s < n; s++ ) {
+                sum += merged[t][s];
+            }
+
+            for( int s = 0; s < n; s++ ) {
+                costs[t * n + s] = std::log2( ( sum + 0.5 * n ) / ( merged[t][s] + 0.5 ) );
+            }
+        }
+
+        // Move each context to its cheapest cluster
+        for( int i = 0; i < used; i++ ) {
+            int    c     = contexts[i];
+            int    best  = tableOf[c];
+            double least = 0;
+
+            for( int t = 0; t < numTables; t++ ) {
+                double bits = 0;
+
+                for( int s = 0; s < n; s++ ) {
+                    bits += counts[c * n + s] * costs[t * n + s];
+                }
+
+                if( t == 0 || bits < least ) {
+                    least = bits;
+                    best  = t;
+                }
+            }
+
+            if( best != tableOf[c] ) {
+                tableOf[c] = best;
+                moved      = true;
+            }
+        }
+
+        if( !moved ) {
+            break;
+        }
+    }
+
+    // Drop clusters left empty and build a table from each of the rest
+    int renumber[MAX_TABLES];
+    int kept = 0;
+
+    for( int t = 0; t < numTables; t++ ) {
+        std::fill( merged[t], merged[t] + n, 0ULL );
+        renumber[t] = -1;
+    }
+
+    for( int i = 0; i < used; i++ ) {
+        int c = contexts[i];
+
+        for( int s = 0; s < n; s++ ) {
+            merged[tableOf[c]][s] += counts[c * n + s];
+        }
+    }
+
+    for( int t = 0; t < numTables; t++ ) {
+        for( int s = 0; s < n && renumber[t] < 0; s++ ) {
+            if( merged[t][s] > 0 ) {
+                renumber[t] = kept++;
+            }
+        }
+    }
+
+    for( int c = 0; c < n; c++ ) {
+        tableOf[c] = ( totals[c] > 0 ) ? renumber[tableOf[c]] : 0;
+    }
+
+    codedBits = 0;
+
+    for( int t = 0; t < numTables; t++ ) {
+        if( renumber[t] < 0 ) {
+            continue;
+        }
+
+        TreeBuilder<unsigned char> tree;
+        tree.setMaxCodeLength( maxCodeLength );
+        tree.setFrequencies( merged[t] );
+
+        if( !tree.build() ) {
+            return false;
+        }
+
+        tables[renumber[t]] = tree.getCodeTable();
+        codedBits          += tree.getCodedBits();
+    }
+
+    numTables = std::max( kept, 1 );
+
+    return true;
+}
+
+/** 
+ * getNumTables()
+ *
+ * Returns number of code tables in use
+ */
+int ContextModel::getNumTables() {
+    return numTables;
+}
+
+/** 
+ * getMaxLength()
+ *
+ * Returns longest code of any table
+ */
+int ContextModel::getMaxLength() {
+    int longest = 0;
+
+    for( int t = 0; t < numTables; t++ ) {
+        longest = std::max( longest, tables[t].getMaxLength() );
+    }
+
+    return longest;
+}
+
+/** 
+ * getCodedBits()
+ *
+ * Returns number of bits the symbols counted
+ * by build() take with the context tables
+ */
+unsigned long long ContextModel::getCodedBits() {
+    return codedBits;
+}
+
+/** 
+ * write()
+ *
+ * Writes the table count, the table of
+ * every context and each table's lengths
+ */
+void ContextModel::write( BitIO &writer ) {
+    writer.writeBits( numTables - 1, TABLE_BITS );
+
+    for( int c = 0; c < CodeTable::NUM_SYMBOLS; c++ ) {
+        writer.writeBits( tableOf[c], TABLE_BITS );
+    }
+
+    for( int t = 0; t < numTables; t++ ) {
+        tables[t].write( writer );
+    }
+}
+
+/** 
+ * read()
+ *
+ * Reads what write() wrote and builds a lookup
+ * table for each code table. Returns false if
+ * a context names a table that was not sent
+ */
+bool ContextModel::read( BitIO &reader ) {
+    numTables = reader.readBits( TABLE_BITS ) + 1;
+
+    for( int c = 0; c < CodeTable::NUM_SYMBOLS; c++ ) {
+        tableOf[c] = reader.readBits( TABLE_BITS );
+
+        if( tableOf[c] >= numTables ) {
+            return false;
+        }
+    }
+
+    for( int t = 0; t < numTables; t++ ) {
+        if( !tables[t].read( reader ) ) {
+            return false;
+        }
+
+        decoders[t].build( tables[t].getLengths(), tables[t].getCodes(), CodeTable::NUM_SYMBOLS );
+    }
+
+    return true;
+}
+
+/** 
+ * encode()
+ *
+ * Writes each symbol with the codes of the
+ * table its previous byte maps to
+ */
+void ContextModel::encode( const unsigned char *src, size_t size, BitIO &writer ) {
+    int previous = 0;
+
+    for( size_t i = 0; i < size; i++ ) {
+        CodeTable &table = tables[tableOf[previous]];
+
+        writer.writeBits( table.getCode( src[i] ), table.getLength( src[i] ) );
+        previous = src[i];
+    }
+}
+
+/** 
+ * decode()
+ *
+ * Decodes rawSize symbols, looking up each with the
+ * table of the symbol before it. Returns false if the
+ * symbols ran past the size bytes the reader was given
+ */
+bool ContextModel::decode( BitIO &reader, size_t size, unsigned char *dst, size_t rawSize ) {
+    int previous = 0;
+
+    for( size_t i = 0; i < rawSize; i++ ) {
+        previous = decoders[tableOf[previous]].decodeSymbol( reader );
+        dst[i]   = (unsigned char) previous;
+    }
+
+    return reader.getBitsRead() <= (unsigned long long) size * 8;
+}
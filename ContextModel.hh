@@ -0,0 +1,69 @@
+/** 
+ * ContextModel.hh
+ *
+ * Class definitions
+ */
+
+#ifndef CONTEXTMODEL_HH
+#define CONTEXTMODEL_HH
+
+// Include libraries
+#include <cstddef>
+#include <vector>
+
+// Include classes
+#include "BitIO.hh"
+#include "CodeTable.hh"
+#include "DecodeTable.hh"
+
+/** 
+ * ContextModel
+ *
+ * Order-1 coding of a block. Every previous byte is a
+ * context, and contexts whose next bytes are alike are
+ * clustered so that at most MAX_TABLES code tables are
+ * sent. Each symbol is coded with the table of the
+ * cluster its previous byte belongs to. The byte before
+ * a block is taken to be zero.
+ *
+ *   model         table count less one (4 bits),
+ *                 table of each context (4 bits each),
+ *                 code lengths of each table as written
+ *                 by CodeTable
+ *
+ * Contexts are clustered by k-means over their counts,
+ * seeded with the busiest contexts, measuring each
+ * cluster by the bits its counts would take
+ */
+class ContextModel {
+    public:
+        static const int MAX_TABLES  = 16;                          // Most code tables sent
+        static const int TABLE_BITS  = 4;                           // Bits of a table number
+        static const int ITERATIONS  = 6;                           // Most k-means rounds
+
+        ContextModel();                                             // Default constructor: one empty table
+
+        bool build( const unsigned char *src, size_t size,          // Counts contexts and builds tables
+                    int maxCodeLength );
+
+        int  getNumTables();                                        // Returns number of tables
+        int  getMaxLength();                                        // Returns longest code of any table
+        unsigned long long getCodedBits();                          // Returns bits of the counted symbols
+
+        void write( BitIO &writer );                                // Writes count, context map and tables
+        bool read( BitIO &reader );                                 // Reads them and builds lookup tables
+
+        void encode( const unsigned char *src, size_t size,         // Writes each symbol with its context's codes
+                     BitIO &writer );
+        bool decode( BitIO &reader, size_t size,                    // Decodes rawSize symbols from size bytes
+                     unsigned char *dst, size_t rawSize );
+
+    private:
+        int                numTables;                               // Code tables in use
+        unsigned char      tableOf[CodeTable::NUM_SYMBOLS];         // Table of each previous byte
+        CodeTable          tables[MAX_TABLES];                      // Codes of each cluster
+        DecodeTable        decoders[MAX_TABLES];                    // Lookup tables once read
+        unsigned long long codedBits;                               // Bits of symbols counted by build()
+};
+
+#endif
@@ -0,0 +1,132 @@
+/** 
+ * DecodeTable.cc
+ *
+ * Class methods and implementation
+ * for decoding prefix codes with lookup
+ * tables instead of walking the tree
+ */
+
+// Include header file
+#include "DecodeTable.hh"
+
+/** 
+ * DecodeTable()
+ *
+ * Default constructor
+ */
+DecodeTable::DecodeTable() {
+    rootBits = 1;
+}
+
+/** 
+ * getRootBits()
+ *
+ * Returns index width of the primary table
+ */
+int DecodeTable::getRootBits() {
+    return rootBits;
+}
+
+/** 
+ * build()
+ *
+ * Builds the lookup tables from the code length and
+ * code word of every symbol. A length of zero means
+ * the symbol does not occur
+ */
+void DecodeTable::build( const int *lengths, const unsigned long long *codes, int numSymbols ) {
+    // Function variables
+    int maxLength = 0;
+    std::vector<int> symbols;
+
+    // Collect symbols in use and longest code
+    for( int s = 0; s < numSymbols; s++ ) {
+        if( lengths[s] > 0 ) {
+            symbols.push_back( s );
+
+            if( lengths[s] > maxLength ) {
+                maxLength = lengths[s];
+            }
+        }
+    }
+
+    // Primary table is no wider than the longest code
+    rootBits = ( maxLength < ROOT_BITS ) ? maxLength : ROOT_BITS;
+
+    if( rootBits < 1 ) {
+        rootBits = 1;
+    }
+
+    // Allocate primary table, subtables are appended after it
+    table.clear();
+    table.resize( 1 << rootBits );
+
+    fill( 0, rootBits, symbols, 0, lengths, codes );
+}
+
+/** 
+ * fill()
+ *
+ * Fills the table at offset, indexed by the next bits
+ * after the first consumed bits of each code. Codes that
+ * fit are replicated across every slot they prefix, longer
+ * codes are grouped by index and moved into subtables
+ */
+void DecodeTable::fill( int offset, int bits, std::vector<int> &symbols, int consumed,
+                        const int *lengths, const unsigned long long *codes ) {
+    // One group of overflowing symbols per slot
+    std::vector< std::vector<int> > groups( 1 << bits );
+
+    for( size_t i = 0; i < symbols.size(); i++ ) {
+        int s         = symbols[i];
+        int remaining = lengths[s] - consumed;
+
+        // Bits of code not yet resolved by parent tables
+        unsigned long long code = codes[s] & ( ( 1ULL << remaining ) - 1 );
+
+        if( remaining <= bits ) {
+            // Replicate leaf across all slots sharing this prefix
+            int first = (int) ( code << ( bits - remaining ) );
+            int count = 1 << ( bits - remaining );
+
+            for( int j = 0; j < count; j++ ) {
+                table[offset + first + j].value   = s;
+                table[offset + first + j].length  = remaining;
+                table[offset + first + j].subBits = 0;
+            }
+        } else {
+            // Defer to the subtable for this slot
+            groups[code >> ( remaining - bits )].push_back( s );
+        }
+    }
+
+    // Build a subtable for every slot with long codes
+    for( int slot = 0; slot < ( 1 << bits ); slot++ ) {
+        if( groups[slot].empty() ) {
+            continue;
+        }
+
+        // Subtable is as wide as the longest code needs, up to SUB_BITS
+        int longest = 0;
+
+        for( size_t i = 0; i < groups[slot].size(); i++ ) {
+            int remaining = lengths[groups[slot][i]] - consumed - bits;
+
+            if( remaining > longest ) {
+                longest = remaining;
+            }
+        }
+
+        int subBits   = ( longest < SUB_BITS ) ? longest : SUB_BITS;
+        int subOffset = table.size();
+
+        table.resize( subOffset + ( 1 << subBits ) );
+
+        // Link slot to subtable
+        table[offset + slot].value   = subOffset;
+        table[offset + slot].length  = 0;
+        table[offset + slot].subBits = subBits;
+
+        fill( subOffset, subBits, groups[slot], consumed + bits, lengths, codes );
+    }
+}
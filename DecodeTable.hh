@@ -0,0 +1,87 @@
+/** 
+ * DecodeTable.hh
+ *
+ * Class definitions
+ */
+
+#ifndef DECODETABLE_HH
+#define DECODETABLE_HH
+
+// Include libraries
+#include <iostream>
+#include <vector>
+
+// Include classes
+#include "BitIO.hh"
+
+/** 
+ * DecodeEntry
+ *
+ * One slot of a lookup table. A leaf slot holds a symbol
+ * and the number of bits its code uses at this level, a
+ * link slot holds the offset and width of a subtable
+ */
+struct DecodeEntry {
+    unsigned int  value;                                            // Symbol (leaf) or subtable offset (link)
+    unsigned char length;                                           // Bits consumed at this level (leaf)
+    unsigned char subBits;                                          // Width of subtable, zero for a leaf
+};
+
+/** 
+ * DecodeTable
+ *
+ * Multi-level lookup table for decoding prefix codes
+ * several bits at a time
+ */
+class DecodeTable {
+    public:
+        static const int ROOT_BITS = 11;                            // Index width of primary table
+        static const int SUB_BITS  = 8;                             // Maximum index width of a subtable
+
+        DecodeTable();                                              // Default constructor
+
+        void build( const int *lengths,                             // Builds table from code lengths and
+                    const unsigned long long *codes,                //   code words indexed by symbol
+                    int numSymbols );
+
+        int  getRootBits();                                         // Returns width of primary table
+        int  decodeSymbol( BitIO &reader );                         // Decodes one symbol from reader
+
+    private:
+        void fill( int offset, int bits,                            // Recursively fills a (sub)table
+                   std::vector<int> &symbols, int consumed,
+                   const int *lengths,
+                   const unsigned long long *codes );
+
+        int rootBits;                                               // Width of primary table in use
+        std::vector<DecodeEntry> table;                             // Primary table followed by subtables
+};
+
+/** 
+ * decodeSymbol()
+ *
+ * Peeks a table index worth of bits, follows links into
+ * subtables for long codes and consumes only the bits
+ * belonging to the decoded symbol. Defined here so the
+ * decode loop can inline it
+ */
+FORCE_INLINE int DecodeTable::decodeSymbol( BitIO &reader ) {
+    // Look up primary table
+    int          bits  = rootBits;
+    DecodeEntry *entry = &table[reader.peekBits( bits )];
+
+    // Follow links for codes longer than this level
+    while( entry -> subBits != 0 ) {
+        reader.skipBits( bits );
+
+        bits  = entry -> subBits;
+        entry = &table[entry -> value + reader.peekBits( bits )];
+    }
+
+    // Consume the remaining bits of the code
+    reader.skipBits( entry -> length );
+
+    return entry -> value;
+}
+
+#endif
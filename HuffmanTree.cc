@@ -5,492 +5,1707 @@
  */
 
 // Include header file
-#include "PriorityQueue.hh"
 #include "HuffmanTree.hh"
 
+// Include libraries
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+
+// Decoded copies are named after the encoded file with this ending
+const char *const HuffmanTree::DECODED_SUFFIX = ".decoded.txt";
+
+/** 
+ * endsWith()
+ *
+ * Returns true if name ends in suffix
+ */
+static bool endsWith( const std::string &name, const std::string &suffix ) {
+    return name.size() >= suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+/** 
+ * HuffmanTree()
+ *
+ * Default constructor
+ */
+HuffmanTree::HuffmanTree() {
+    blockSize     = BlockCodec::DEFAULT_BLOCK_SIZE;
+    numThreads    = ThreadPool::defaultThreads();
+    maxCodeLength = 0;
+    numStreams    = 1;
+    sharedTable   = NULL;
+    contextModel  = false;
+    statsFormat   = STATS_TEXT;
+
+    BlockCodec::clearStats( totals );
+}
+
+/** 
+ * getRoot()
+ *
+ * Returns root of Huffman Tree
+ */
+Node* HuffmanTree::getRoot() {
+    return builder.getRoot();
+}
+
+/** 
+ * setBlockSize()
+ *
+ * Sets number of raw bytes per block,
+ * clamped to the supported range
+ */
+void HuffmanTree::setBlockSize( size_t size ) {
+    if( size < BlockCodec::MIN_BLOCK_SIZE ) {
+        size = BlockCodec::MIN_BLOCK_SIZE;
+    } else if( size > BlockCodec::MAX_BLOCK_SIZE ) {
+        size = BlockCodec::MAX_BLOCK_SIZE;
+    }
+
+    blockSize = size;
+}
+
+/** 
+ * setMaxCodeLength()
+ *
+ * Sets longest code buildHuffmanTree() may
+ * produce, zero for no limit of our own
+ */
+void HuffmanTree::setMaxCodeLength( int length ) {
+    if( length < 0 || length > CodeTable::MAX_CODE_LENGTH ) {
+        length = 0;
+    }
+
+    maxCodeLength = length;
+    builder.setMaxCodeLength( length );
+}
+
+/** 
+ * getMaxCodeLength()
+ *
+ * Returns code length limit, zero if none
+ */
+int HuffmanTree::getMaxCodeLength() {
+    return maxCodeLength;
+}
+
+/** 
+ * setNumStreams()
+ *
+ * Sets number of interleaved bitstreams
+ * per encoded block, 1 or 4
+ */
+void HuffmanTree::setNumStreams( int n ) {
+    numStreams = ( n == BlockCodec::NUM_STREAMS ) ? n : 1;
+}
+
+/** 
+ * setSharedTable()
+ *
+ * Sets a loaded table that encoded blocks may
+ * name instead of their own, and that decoding
+ * needs for blocks coded with it
+ */
+void HuffmanTree::setSharedTable( SharedTable *table ) {
+    sharedTable = table;
+}
+
+/** 
+ * setContextModel()
+ *
+ * Sets whether blocks may be coded with
+ * order-1 context tables
+ */
+void HuffmanTree::setContextModel( bool enabled ) {
+    contextModel = enabled;
+}
+
+/** 
+ * setStatsFormat()
+ *
+ * Sets whether results are printed as an aligned
+ * summary or as one JSON object per file
+ */
+void HuffmanTree::setStatsFormat( StatsFormat format ) {
+    statsFormat = format;
+}
+
+/** 
+ * setNumThreads()
+ *
+ * Sets number of worker threads used by
+ * encode() and decode()
+ */
+void HuffmanTree::setNumThreads( int n ) {
+    numThreads = ( n > 0 ) ? n : 1;
+}
+
+/** 
+ * getFrequency()
+ *
+ * Returns number of times a symbol was counted
+ */
+unsigned long long HuffmanTree::getFrequency( int symbol ) {
+    return builder.getFrequency( symbol );
+}
+
+/** 
+ * getCodeTable()
+ *
+ * Returns canonical codebook built
+ * by buildHuffmanTree()
+ */
+CodeTable& HuffmanTree::getCodeTable() {
+    return builder.getCodeTable();
+}
+
+/** 
+ * countFrequencies()
+ *
+ * Populate frequency table from file,
+ * a large chunk at a time
+ */
+void HuffmanTree::countFrequencies( std::ifstream &inputFile ) {
+    // Function variables
+    std::vector<unsigned char> chunk( COUNT_CHUNK );
+
+    // Run through file a chunk at a time
+    while( true ) {
+        inputFile.read( (char *) &chunk[0], chunk.size() );
+
+        size_t n = inputFile.gcount();
+
+        if( n == 0 ) {
+            break;
+        }
+
+        countFrequencies( &chunk[0], n );
+    }
+}
+
+/** 
+ * countFrequencies()
+ *
+ * Adds the bytes of a buffer to the frequency table
+ * with the histogram kernel chosen for this CPU
+ */
+void HuffmanTree::countFrequencies( const unsigned char *data, size_t size ) {
+    builder.countFrequencies( data, size );
+}
+
+/** 
+ * setFrequencies()
+ *
+ * Replaces frequency table with counts
+ * made elsewhere
+ */
+void HuffmanTree::setFrequencies( const unsigned long long *counts ) {
+    builder.setFrequencies( counts );
+}
+
+/** 
+ * getNumSymbols()
+ *
+ * Returns number of distinct symbols counted
+ */
+int HuffmanTree::getNumSymbols() {
+    return builder.getNumSymbols();
+}
+
+/** 
+ * buildHuffmanTree()
+ *
+ * Builds the Huffman Tree and canonical codes of
+ * the counted bytes within the code length limit
+ */
+void HuffmanTree::buildHuffmanTree() {
+    if( builder.getNumSymbols() == 0 ) {
+        std::cout << "An error has occured when building the Huffman Tree" << std::endl;
+        std::cout << "Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    if( !builder.build() ) {
+        std::cout << "  Code lengths exceed " << CodeTable::MAX_CODE_LENGTH << " bits" << std::endl;
+        std::cout << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+}
+
+/** 
+ * getCodedBits()
+ *
+ * Returns number of bits the counted symbols
+ * take with the current code lengths
+ */
+unsigned long long HuffmanTree::getCodedBits() {
+    return builder.getCodedBits();
+}
+
+/** 
+ * getUnlimitedBits()
+ *
+ * Returns number of bits the counted symbols would
+ * take without a limit on code length
+ */
+unsigned long long HuffmanTree::getUnlimitedBits() {
+    return builder.getUnlimitedBits();
+}
+
+/** 
+ * getEntropyBits()
+ *
+ * Returns the Shannon bound of the counted
+ * symbols, the bits an ideal code would take
+ */
+double HuffmanTree::getEntropyBits() {
+    return builder.getEntropyBits();
+}
+
+/** 
+ * encode()
+ *
+ * Creates encoded file as a container of independently
+ * coded blocks. The output is mapped at the worst case
+ * size, filled by Codec::compress() straight from the
+ * mapped input and cut down to the real size at the end
+ */
+void HuffmanTree::encode( std::string filename, MappedFile &input ) {
+    // Function variables
+    size_t       size = input.getSize();
+    size_t       written;
+    CodecOptions options = getCodecOptions();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Prepare output filename
+    int pos = filename.find( ".txt" );
+    std::string outputFilename = filename.substr( 0, pos ) + ".huf";
+
+    if( statsFormat == STATS_TEXT ) {
+        std::cout << "  Encoded file is called " << outputFilename << std::endl;
+    }
+
+    // Map output file
+    MappedFile output;
+    size_t     bound = Codec::compressBound( size, blockSize );
+
+    if( !output.create( outputFilename, bound ) ) {
+        std::cout << "  Error opening output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    CodecStatus status = Codec::compress( input.getData(), size, output.getData(), bound, written, options, &totals );
+
+    if( status != CODEC_OK ) {
+        std::cout << "  Error compressing: " << Codec::describe( status ) << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // Cut output down to what was written
+    std::chrono::steady_clock::time_point flush = std::chrono::steady_clock::now();
+
+    if( !output.finish( written ) ) {
+        std::cout << "  Error writing output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    totals.flushSeconds += std::chrono::duration<double>( end - flush ).count();
+
+    if( statsFormat == STATS_JSON ) {
+        printStats( std::cout, "encode", filename, size, written,
+                    std::chrono::duration<double>( end - start ).count(), totals );
+        return;
+    }
+
+    // Print out compression data
+    std::cout << std::endl;
+    std::cout << "    Size of original file:" << std::setw(10) << size
+                                              << std::setw(6)  << "bytes" << std::endl;
+    std::cout << "  Size of compressed file:" << std::setw(10) << written
+                                              << std::setw(6)  << "bytes" << std::endl;
+    std::cout << "        Compression ratio:" << std::setw(10) << (double) written / (double) size << std::endl;
+
+    // Blocks copied because coding would not shrink them
+    if( totals.numStored > 0 ) {
+        std::cout << "            Stored blocks:" << std::setw(10) << totals.numStored
+                                                  << std::setw(3)  << "of" << " " << totals.numBlocks << std::endl;
+    }
+
+    // Blocks coded with order-1 context tables
+    if( totals.numContext > 0 ) {
+        std::cout << "           Context blocks:" << std::setw(10) << totals.numContext
+                                                  << std::setw(3)  << "of" << " " << totals.numBlocks << std::endl;
+    }
+
+    // Blocks coded with a table sent earlier
+    if( totals.numReused > 0 ) {
+        std::cout << "            Reused tables:" << std::setw(10) << totals.numReused
+                                                  << std::setw(3)  << "of" << " " << totals.numBlocks << std::endl;
+    }
+
+    // Cost of keeping codes within the length limit
+    if( maxCodeLength > 0 ) {
+        unsigned long long extra = ( totals.codedBits - totals.unlimitedBits + 7 ) / 8;
+
+        std::cout << "        Length limit cost:" << std::setw(10) << extra
+                                                  << std::setw(6)  << "bytes"
+                  << " (" << 100.0 * extra / ( ( totals.unlimitedBits + 7 ) / 8 ) << "%)" << std::endl;
+    }
+}
+
+/** 
+ * decode()
+ *
+ * Decodes encoded file
+ * Reads the original size from the block index, maps an
+ * output of that size and lets Codec::decompress() decode
+ * every block straight into its place
+ */
+void HuffmanTree::decode( std::string filename, MappedFile &input ) {
+    // Function variables
+    int                pos;
+    unsigned long long size;
+    size_t             written;
+    CodecOptions       options = getCodecOptions();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Adaptive files carry no index
+    if( input.getSize() >= AdaptiveHuffman::MAGIC_SIZE && AdaptiveHuffman::checkMagic( input.getData() ) ) {
+        decodeAdaptive( filename, input );
+        return;
+    }
+
+    // Locate blocks
+    if( Codec::decompressedSize( input.getData(), input.getSize(), size ) != CODEC_OK ) {
+        std::cout << "  Not a supported encoded file" << std::endl;
+        std::cout << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // Prepare output filename
+    pos = filename.find( ".huf" );
+    std::string outputFilename = filename.substr( 0, pos ) + DECODED_SUFFIX;
+
+    if( statsFormat == STATS_TEXT ) {
+        std::cout << "  Beginning decoding process ..." << std::endl;
+    }
+
+    // Map output file
+    MappedFile output;
+
+    if( !output.create( outputFilename, size ) ) {
+        std::cout << "  Error opening output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // Decode every block concurrently, each into its own slice
+    if( Codec::decompress( input.getData(), input.getSize(), output.getData(), size, written, options ) != CODEC_OK ) {
+        std::cout << "  Corrupt block, or coded with a shared table not given" << std::endl;
+        std::cout << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // Close files
+    std::chrono::steady_clock::time_point flush = std::chrono::steady_clock::now();
+
+    output.finish( size );
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    totals.flushSeconds += std::chrono::duration<double>( end - flush ).count();
+
+    if( statsFormat == STATS_JSON ) {
+        printStats( std::cout, "decode", filename, input.getSize(), size,
+                    std::chrono::duration<double>( end - start ).count(), totals );
+        input.close();
+        return;
+    }
+
+    input.close();
+
+    // Ending declaration
+    std::cout << "  Finished decoding ..." << std::endl;
+    std::cout << "  Decoded file is called " << outputFilename << std::endl;
+}
+
+/** 
+ * decodeRange()
+ *
+ * Decodes length bytes from offset of an encoded file,
+ * cut short at its end, and writes them to output. Only
+ * the blocks the index places in the range are decoded,
+ * a slice of at most RANGE_BUFFER_LIMIT bytes at a time.
+ * Returns false and reports on stderr if the range could
+ * not be decoded
+ */
+bool HuffmanTree::decodeRange( std::string filename, MappedFile &input, unsigned long long offset,
+                               unsigned long long length, int output ) {
+    // Function variables
+    unsigned long long   size;
+    unsigned long long   done = 0;
+    size_t               written;
+    CodecOptions         options = getCodecOptions();
+    CodecStatus          status;
+    std::vector<uint8_t> buffer;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Adaptive files carry no index
+    if( input.getSize() >= AdaptiveHuffman::MAGIC_SIZE && AdaptiveHuffman::checkMagic( input.getData() ) ) {
+        std::cerr << "  Ranges need a block container, not an adaptive file" << std::endl;
+        return false;
+    }
+
+    if( Codec::decompressedSize( input.getData(), input.getSize(), size ) != CODEC_OK ) {
+        std::cerr << "  Not a supported encoded file" << std::endl;
+        return false;
+    }
+
+    if( offset > size ) {
+        std::cerr << "  Range starts past the end of the " << size << " decoded bytes" << std::endl;
+        return false;
+    }
+
+    length = std::min( length, size - offset );
+    buffer.resize( std::min( length, (unsigned long long) RANGE_BUFFER_LIMIT ) );
+
+    while( done < length ) {
+        unsigned long long slice = std::min( length - done, (unsigned long long) buffer.size() );
+
+        status = Codec::decompressRange( input.getData(), input.getSize(), offset + done, slice,
+                                         buffer.data(), buffer.size(), written, options );
+
+        if( status != CODEC_OK ) {
+            std::cerr << "  Corrupt block, or coded with a shared table not given" << std::endl;
+            return false;
+        }
+
+        if( !writeFully( output, buffer.data(), written ) ) {
+            std::cerr << "  Error writing decoded range" << std::endl;
+            return false;
+        }
+
+        done += written;
+    }
+
+    if( statsFormat == STATS_JSON ) {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        printStats( std::cerr, "range", filename, input.getSize(), length,
+                    std::chrono::duration<double>( end - start ).count(), totals );
+    }
+
+    return true;
+}
+
+/** 
+ * getCodecOptions()
+ *
+ * Returns block size, threads and code length
+ * limit as options for the buffer API
+ */
+CodecOptions HuffmanTree::getCodecOptions() {
+    CodecOptions options;
+
+    options.blockSize     = blockSize;
+    options.numThreads    = numThreads;
+    options.maxCodeLength = maxCodeLength;
+    options.numStreams    = numStreams;
+    options.sharedTable   = sharedTable;
+    options.contextModel  = contextModel;
+
+    return options;
+}
+
+/** 
+ * encodeStream()
+ *
+ * Encodes a pipe in a single pass. Input is read one
+ * block at a time, each block gets its own table and is
+ * written out as soon as it and the blocks before it are
+ * compressed, so memory stays bounded by the blocks in
+ * flight however long the input is
+ */
+void HuffmanTree::encodeStream( int input, int output ) {
+    // Function variables
+    unsigned char              header[BlockCodec::MAX_FILE_HEADER_SIZE];
+    std::deque<BlockJob *>     pending;
+    std::vector<BlockEntry>    index;
+    std::vector<unsigned char> trailer;
+    bool                       ok  = true;
+    bool                       end = false;
+    unsigned long long         bytesIn = 0, bytesOut;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Write container header
+    bytesOut = BlockCodec::writeFileHeader( header, blockSize );
+    ok       = writeFully( output, header, bytesOut );
+
+    ThreadPool             pool( numThreads );
+    size_t                 maxInFlight = 2 * pool.getNumThreads();
+    BlockOptions           options;
+    std::deque<BlockJob *> analyzing;
+    TableChain             chain;
+
+    options.maxCodeLength = maxCodeLength;
+    options.numStreams    = numStreams;
+    options.sharedTable   = sharedTable;
+    options.contextModel  = contextModel;
+
+    chain.valid = false;
+    chain.block = 0;
+    chain.next  = 0;
+
+    while( ok && !end ) {
+        BlockJob *job = new BlockJob();
+
+        // Read next block
+        job -> owned.resize( blockSize );
+        job -> srcSize = readFully( input, &( job -> owned[0] ), blockSize );
+        job -> src     = &( job -> owned[0] );
+        job -> rawSize = job -> srcSize;
+
+        // A short block means the input has ended
+        end      = ( job -> srcSize < blockSize );
+        bytesIn += job -> srcSize;
+
+        Kernels::prepare( bytesIn );
+
+        if( job -> srcSize > 0 ) {
+            job -> done = pool.submit( [job, options]() {
+                job -> ok = BlockCodec::analyze( job -> src, job -> srcSize, options, job -> plan, job -> stats );
+            } );
+
+            analyzing.push_back( job );
+        } else {
+            delete job;
+        }
+
+        // Pick tables in order, then compress on a worker
+        while( !analyzing.empty() && ( analyzing.size() >= maxInFlight || end ) ) {
+            job = analyzing.front();
+            analyzing.pop_front();
+
+            // A block that could not be analyzed fails when it is written
+            if( !Codec::chooseBlock( job, options, chain ) ) {
+                pending.push_back( job );
+                continue;
+            }
+
+            job -> done = pool.submit( [job, options]() {
+                job -> ok = BlockCodec::compress( job -> src, job -> srcSize, job -> plan, job -> result, options, job -> stats );
+            } );
+
+            pending.push_back( job );
+        }
+
+        // Write blocks in order, the oldest once too many are in flight
+        while( ok && !pending.empty() && ( pending.size() >= maxInFlight || end ) ) {
+            job = pending.front();
+            pending.pop_front();
+
+            if( !Codec::finishBlock( job, index, totals ) ) {
+                std::cerr << "  Error compressing block" << std::endl;
+                std::cerr << "  Exiting..." << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            std::chrono::steady_clock::time_point flush = std::chrono::steady_clock::now();
+
+            ok = writeFully( output, job -> header, job -> headerSize ) &&
+                 writeFully( output, job -> result.data(), job -> result.size() );
+
+            totals.flushSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - flush ).count();
+            bytesOut            += job -> headerSize + job -> result.size();
+
+            delete job;
+        }
+    }
+
+    // End marker and index
+    trailer.push_back( 0 );
+    BlockCodec::writeIndex( trailer, index );
+
+    if( !ok || !writeFully( output, trailer.data(), trailer.size() ) ) {
+        std::cerr << "  Error writing output" << std::endl;
+        std::cerr << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    bytesOut += trailer.size();
+
+    // Standard output carries the data, so results go to standard error
+    if( statsFormat == STATS_JSON ) {
+        printStats( std::cerr, "encode", "-", bytesIn, bytesOut,
+                    std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(), totals );
+    }
+}
+
+/** 
+ * decodeStream()
+ *
+ * Decodes a pipe in a single pass. Blocks are read in
+ * turn until the end marker, decoded on worker threads
+ * and written out in order. The index after the end
+ * marker is not needed and is left unread. An adaptive
+ * stream is handed to decodeAdaptiveStream()
+ */
+void HuffmanTree::decodeStream( int input, int output ) {
+    // Function variables
+    unsigned char          magic[BlockCodec::MAGIC_SIZE] = { 0 };
+    unsigned long long     maxBlock, rawSize, packedSize;
+    std::deque<BlockJob *> pending;
+    bool                   ok  = true;
+    bool                   end = false;
+
+    // Check container header
+    readFully( input, magic, sizeof( magic ) );
+
+    if( AdaptiveHuffman::checkMagic( magic ) ) {
+        decodeAdaptiveStream( input, output );
+        return;
+    }
+
+    if( !BlockCodec::checkMagic( magic ) ||
+        !readVarint( input, maxBlock ) ||
+        maxBlock < BlockCodec::MIN_BLOCK_SIZE || maxBlock > BlockCodec::MAX_BLOCK_SIZE ) {
+        std::cerr << "  Not a supported encoded stream" << std::endl;
+        std::cerr << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    ThreadPool                 pool( numThreads );
+    size_t                     maxInFlight = 2 * pool.getNumThreads();
+    std::vector<unsigned char> carried;
+    unsigned long long         sinceCarried = 0;
+
+    while( ok && !end ) {
+        // Block header, the end marker is a raw size of zero
+        if( !readVarint( input, rawSize ) || rawSize > maxBlock ) {
+            ok = false;
+            break;
+        }
+
+        end = ( rawSize == 0 );
+
+        if( !end ) {
+            if( !readVarint( input, packedSize ) || packedSize > BlockCodec::packedBound( rawSize ) ) {
+                ok = false;
+                break;
+            }
+
+            BlockJob *job = new BlockJob();
+
+            // Read payload
+            job -> owned.resize( packedSize );
+            job -> srcSize = packedSize;
+            job -> src     = job -> owned.data();
+            job -> rawSize = rawSize;
+
+            if( readFully( input, job -> owned.data(), packedSize ) != packedSize ) {
+                delete job;
+                ok = false;
+                break;
+            }
+
+            // Keep layout and table of the last block carrying one for
+            // blocks that reuse it, the distance must lead back to it
+            unsigned char      layout = ( packedSize > 0 ) ? job -> owned[0] : BlockCodec::LAYOUT_STORED;
+            unsigned long long distance;
+
+            sinceCarried++;
+
+            if( layout == BlockCodec::LAYOUT_SINGLE || layout == BlockCodec::LAYOUT_STREAMS ) {
+                size_t keep = std::min( (size_t) packedSize, (size_t) CodeTable::MAX_HEADER_BYTES + 1 );
+
+                carried.assign( job -> owned.begin(), job -> owned.begin() + keep );
+                sinceCarried = 0;
+            } else if( layout == BlockCodec::LAYOUT_REUSE ) {
+                if( carried.empty() || BlockCodec::getVarint( job -> owned.data() + 1, packedSize - 1, distance ) == 0 ||
+                    distance != sinceCarried ) {
+                    delete job;
+                    ok = false;
+                    break;
+                }
+
+                job -> reused = carried;
+            }
+
+            job -> done = pool.submit( [job, this]() {
+                job -> result.resize( job -> rawSize );
+                job -> ok = BlockCodec::decompress( job -> src, job -> srcSize, &( job -> result[0] ), job -> rawSize, sharedTable,
+                                                    job -> reused.data(), job -> reused.size() );
+            } );
+
+            pending.push_back( job );
+        }
+
+        // Write blocks in order, the oldest once too many are in flight
+        while( ok && !pending.empty() && ( pending.size() >= maxInFlight || end ) ) {
+            BlockJob *job = pending.front();
+            pending.pop_front();
+
+            job -> done.wait();
+
+            ok = job -> ok && writeFully( output, job -> result.data(), job -> result.size() );
+
+            delete job;
+        }
+    }
+
+    if( !ok ) {
+        std::cerr << "  Corrupt or truncated stream" << std::endl;
+        std::cerr << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+}
+
+/** 
+ * encodeAdaptive()
+ *
+ * Creates an adaptive encoded file in a single pass
+ * over the mapped input, a chunk at a time
+ */
+void HuffmanTree::encodeAdaptive( std::string filename, MappedFile &input ) {
+    // Function variables
+    std::vector<unsigned char> buffer;
+    size_t                     size    = input.getSize();
+    size_t                     written = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Prepare output filename
+    int pos = filename.find( ".txt" );
+    std::string outputFilename = filename.substr( 0, pos ) + ".huf";
+
+    if( statsFormat == STATS_TEXT ) {
+        std::cout << "  Encoded file is called " << outputFilename << std::endl;
+    }
+
+    int output = open( outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    if( output < 0 ) {
+        std::cout << "  Error opening output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    bool ok = writeAdaptiveFile( input.getData(), size, output, buffer, written );
+
+    if( close( output ) != 0 || !ok ) {
+        std::cout << "  Error writing output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    if( statsFormat == STATS_JSON ) {
+        printStats( std::cout, "adaptive", filename, size, written,
+                    std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(), totals );
+        return;
+    }
+
+    // Print out compression data
+    std::cout << std::endl;
+    std::cout << "    Size of original file:" << std::setw(10) << size
+                                              << std::setw(6)  << "bytes" << std::endl;
+    std::cout << "  Size of compressed file:" << std::setw(10) << written
+                                              << std::setw(6)  << "bytes" << std::endl;
+    std::cout << "        Compression ratio:" << std::setw(10) << (double) written / (double) size << std::endl;
+}
+
+/** 
+ * decodeAdaptive()
+ *
+ * Decodes an adaptive file a chunk at a time.
+ * Its size is only known once the end marker
+ * is reached, so the output is written, not mapped
+ */
+void HuffmanTree::decodeAdaptive( std::string filename, MappedFile &input ) {
+    // Function variables
+    std::vector<unsigned char> decoded;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Prepare output filename
+    int pos = filename.find( ".huf" );
+    std::string outputFilename = filename.substr( 0, pos ) + DECODED_SUFFIX;
+
+    if( statsFormat == STATS_TEXT ) {
+        std::cout << "  Beginning decoding process ..." << std::endl;
+    }
+
+    int output = open( outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    if( output < 0 ) {
+        std::cout << "  Error opening output file" << std::endl;
+        std::cout << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    bool  ok       = readAdaptiveFile( input.getData(), input.getSize(), output, decoded );
+    off_t bytesOut = lseek( output, 0, SEEK_CUR );
+
+    if( close( output ) != 0 || !ok ) {
+        std::cout << "  Corrupt or truncated file" << std::endl;
+        std::cout << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    if( statsFormat == STATS_JSON ) {
+        printStats( std::cout, "decode", filename, input.getSize(), bytesOut,
+                    std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(), totals );
+        input.close();
+        return;
+    }
+
+    input.close();
+
+    // Ending declaration
+    std::cout << "  Finished decoding ..." << std::endl;
+    std::cout << "  Decoded file is called " << outputFilename << std::endl;
+}
+
 /** 
- * getRoot()
+ * encodeAdaptiveStream()
  *
- * Returns root of Huffman Tree
+ * Encodes a pipe with the adaptive coder. Whatever
+ * a read returns is coded and written at once, ending
+ * on a flush marker, so the decoder can print it
+ * without waiting for more input
  */
-Node* HuffmanTree::getRoot() {
-    return root;
+void HuffmanTree::encodeAdaptiveStream( int input, int output ) {
+    // Function variables
+    AdaptiveHuffman            coder;
+    unsigned char              header[AdaptiveHuffman::MAGIC_SIZE];
+    std::vector<unsigned char> chunk( ADAPTIVE_CHUNK );
+    std::vector<unsigned char> buffer( AdaptiveHuffman::encodeBound( ADAPTIVE_CHUNK ) );
+    size_t                     written = 0;
+    bool                       ok;
+
+    ok = writeFully( output, header, AdaptiveHuffman::writeHeader( header ) );
+
+    while( ok ) {
+        ssize_t n = read( input, chunk.data(), chunk.size() );
+
+        if( n < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if( n < 0 ) {
+            ok = false;
+            break;
+        }
+
+        // End of input writes the end marker
+        ok = writeAdaptive( coder, chunk.data(), n, n == 0, buffer, output, written );
+
+        if( n == 0 ) {
+            break;
+        }
+    }
+
+    if( !ok ) {
+        std::cerr << "  Error writing output" << std::endl;
+        std::cerr << "  Exiting..." << std::endl;
+        exit( EXIT_FAILURE );
+    }
 }
 
 /** 
- * countFrequencies()
+ * decodeAdaptiveStream()
  *
- * Populate frequency table from file
+ * Decodes an adaptive pipe whose magic has already
+ * been read. Symbols are written as soon as the bytes
+ * completing them arrive
  */
-void HuffmanTree::countFrequencies( std::ifstream &inputFile ) {
+void HuffmanTree::decodeAdaptiveStream( int input, int output ) {
     // Function variables
-    char c;
+    AdaptiveHuffman            coder;
+    AdaptiveStatus             status = ADAPTIVE_MORE;
+    std::vector<unsigned char> chunk( ADAPTIVE_CHUNK );
+    std::vector<unsigned char> decoded;
+    bool                       ok = true;
+
+    while( ok && status == ADAPTIVE_MORE ) {
+        ssize_t n = read( input, chunk.data(), chunk.size() );
 
-    // Run through file
-    while( !inputFile.eof() ) {
-        // Read each character in file
-        c = inputFile.get();
+        if( n < 0 && errno == EINTR ) {
+            continue;
+        }
 
-        if( (int) c != EOF ) {
-            // Iterate counters in map
-            frequencies[(int) c]++;
+        if( n <= 0 ) {
+            break;
         }
+
+        decoded.clear();
+        status = coder.decode( chunk.data(), n, decoded );
+        ok     = writeFully( output, decoded.data(), decoded.size() );
+    }
+
+    if( !ok || status != ADAPTIVE_END ) {
+        std::cerr << "  Corrupt or truncated stream" << std::endl;
+        std::cerr << "  Exiting ..." << std::endl;
+        exit( EXIT_FAILURE );
     }
 }
 
 /** 
- * buildPriorityQueue()
+ * writeAdaptiveFile()
+ *
+ * Writes the adaptive header and codes data a chunk
+ * at a time, ending on the end marker. Sets written
+ * to the bytes written. Returns false on error
+ */
+bool HuffmanTree::writeAdaptiveFile( const unsigned char *data, size_t size, int fd,
+                                     std::vector<unsigned char> &buffer, size_t &written ) {
+    // Function variables
+    AdaptiveHuffman coder;
+    unsigned char   header[AdaptiveHuffman::MAGIC_SIZE];
+    size_t          offset = 0;
+    bool            ok;
+
+    buffer.resize( AdaptiveHuffman::encodeBound( ADAPTIVE_CHUNK ) );
+
+    written = AdaptiveHuffman::writeHeader( header );
+    ok      = writeFully( fd, header, written );
+
+    // An empty input still gets its end marker
+    do {
+        size_t length = ( size - offset < ADAPTIVE_CHUNK ) ? size - offset : ADAPTIVE_CHUNK;
+
+        ok      = ok && writeAdaptive( coder, data + offset, length, offset + length == size, buffer, fd, written );
+        offset += length;
+    } while( ok && offset < size );
+
+    return ok;
+}
+
+/** 
+ * readAdaptiveFile()
  *
- * Constructs a min-heap priority queue
+ * Decodes a whole adaptive file, header included,
+ * a chunk at a time into fd. Returns false unless
+ * the end marker is reached and every byte written
  */
-void HuffmanTree::buildPriorityQueue( PriorityQueue &PQ ) {
-    // Create iterator
-    std::tr1::unordered_map< int, int >::iterator it;
+bool HuffmanTree::readAdaptiveFile( const unsigned char *data, size_t size, int fd,
+                                    std::vector<unsigned char> &decoded ) {
+    // Function variables
+    AdaptiveHuffman coder;
+    AdaptiveStatus  status = ADAPTIVE_MORE;
+    bool            ok     = true;
 
-    // Loop through frequency table
-    for( it = frequencies.begin(); it != frequencies.end(); it++ ) {
-        // Store key and value
-        int key   = it -> first;
-        int value = it -> second;
+    if( size < AdaptiveHuffman::MAGIC_SIZE || !AdaptiveHuffman::checkMagic( data ) ) {
+        return false;
+    }
 
-        // Create a new node
-        Node *n = new Node();
-        n -> value     = key;
-        n -> frequency = value;
-        n -> left      = NULL;      // Indicates this is a leaf node
-        n -> right     = NULL;      // Indicates this is a leaf node
+    for( size_t offset = AdaptiveHuffman::MAGIC_SIZE; ok && status == ADAPTIVE_MORE && offset < size; offset += ADAPTIVE_CHUNK ) {
+        size_t length = ( size - offset < ADAPTIVE_CHUNK ) ? size - offset : ADAPTIVE_CHUNK;
 
-        // Insert leaf node into priority queue
-        PQ.insert( n );
+        decoded.clear();
+        status = coder.decode( data + offset, length, decoded );
+        ok     = writeFully( fd, decoded.data(), decoded.size() );
     }
+
+    return ok && status == ADAPTIVE_END;
 }
 
 /** 
- * buildHuffmanTree()
+ * writeAdaptive()
  *
- * Constructs Huffman Tree from
- * min-heap priority queue
+ * Codes a chunk into buffer, ends it with a flush
+ * marker, or the end marker if it is the last, and
+ * writes it out. Adds bytes written to written
  */
-void HuffmanTree::buildHuffmanTree() {
-    // Check if we will have potential overflow
-    if( frequencies.size() > 255 ) {
-        std::cout << "  Warning: Potential overflow of characters" << std::endl;
+bool HuffmanTree::writeAdaptive( AdaptiveHuffman &coder, const unsigned char *data, size_t size, bool last,
+                                 std::vector<unsigned char> &buffer, int fd, size_t &written ) {
+    BitIO writer( buffer.data(), buffer.size() );
+
+    coder.encode( data, size, writer );
+
+    if( last ) {
+        coder.finish( writer );
+    } else {
+        coder.flush( writer );
     }
 
-    // Create priority queue
-    PriorityQueue PQ( frequencies.size() );
+    written += writer.getBytesWritten();
+
+    return !writer.hasOverflowed() && writeFully( fd, buffer.data(), writer.getBytesWritten() );
+}
+
+/** 
+ * encodeBatch()
+ *
+ * Encodes every file on the worker pool
+ */
+int HuffmanTree::encodeBatch( const std::vector<std::string> &files, bool adaptive ) {
+    return runBatch( files, true, adaptive );
+}
+
+/** 
+ * decodeBatch()
+ *
+ * Decodes every file on the worker pool
+ */
+int HuffmanTree::decodeBatch( const std::vector<std::string> &files ) {
+    return runBatch( files, false, false );
+}
 
-    // Build priority queue
-    buildPriorityQueue( PQ );
+/** 
+ * runBatch()
+ *
+ * Hands each file to the pool as its own task. Every
+ * file is coded on one worker with that worker's
+ * buffers, so many small files cost no thread hand
+ * offs or allocations of their own. A line is printed
+ * per file as it finishes, then a summary. Returns
+ * number of files that failed
+ */
+int HuffmanTree::runBatch( const std::vector<std::string> &files, bool encoding, bool adaptive ) {
+    // Function variables
+    std::vector<BatchResult>  results( files.size() );
+    std::vector<BatchBuffers> buffers( numThreads );
+    std::mutex                print;
+    unsigned long long        rawTotal = 0, packedTotal = 0;
+    int                       failed   = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    {
+        ThreadPool pool( numThreads );
+
+        for( size_t i = 0; i < files.size(); i++ ) {
+            BatchResult *result = &results[i];
+
+            result -> filename   = files[i];
+            result -> ok         = false;
+            result -> error      = "";
+            result -> rawSize    = 0;
+            result -> packedSize = 0;
+            result -> seconds    = 0;
+
+            BlockCodec::clearStats( result -> stats );
+
+            pool.submit( [this, result, &buffers, &print, encoding, adaptive]() {
+                BatchBuffers &mine = buffers[ThreadPool::currentWorker()];
+
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+                result -> ok      = encoding ? encodeBatchFile( *result, mine, adaptive ) : decodeBatchFile( *result, mine );
+                result -> seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+
+                std::lock_guard<std::mutex> guard( print );
+
+                // Each file is reported as it would be on its own
+                if( statsFormat == STATS_JSON && result -> ok ) {
+                    unsigned long long in  = encoding ? result -> rawSize : result -> packedSize;
+                    unsigned long long out = encoding ? result -> packedSize : result -> rawSize;
+
+                    printStats( std::cout, encoding ? ( adaptive ? "adaptive" : "encode" ) : "decode",
+                                result -> filename, in, out, result -> seconds, result -> stats );
+                } else if( statsFormat == STATS_JSON ) {
+                    std::cout << "{\"mode\":" << quoteJson( encoding ? ( adaptive ? "adaptive" : "encode" ) : "decode" )
+                              << ",\"file\":" << quoteJson( result -> filename ) << ",\"ok\":false"
+                              << ",\"error\":" << quoteJson( result -> error ) << "}" << std::endl;
+                } else if( result -> ok && encoding ) {
+                    std::cout << "  ok    " << result -> filename << "  " << result -> rawSize
+                              << " -> " << result -> packedSize << " bytes" << std::endl;
+                } else if( result -> ok ) {
+                    std::cout << "  ok    " << result -> filename << "  " << result -> packedSize
+                              << " -> " << result -> rawSize << " bytes" << std::endl;
+                } else {
+                    std::cout << "  FAIL  " << result -> filename << ": " << result -> error << std::endl;
+                }
+            } );
+        }
+    }
 
-    // Build Huffman Tree from priority queue
-    // with linked list tree implementation
-    while( PQ.getTail() > 1 ) {
-        // Create new node
-        Node *z = new Node();
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
 
-        // Create temporary node pointers
-        Node *x = PQ.removeMin();
-        Node *y = PQ.removeMin();
+    for( size_t i = 0; i < results.size(); i++ ) {
+        if( results[i].ok ) {
+            rawTotal    += results[i].rawSize;
+            packedTotal += results[i].packedSize;
+        } else {
+            failed++;
+        }
+    }
 
-        // Update pointers
-        z -> left = x;
-        z -> right = y;
+    if( statsFormat == STATS_JSON ) {
+        std::ostringstream line;
 
-        // Set freqeuncy of new node
-        z -> frequency = x -> frequency + y -> frequency;
+        line << std::setprecision(6)
+             << "{\"mode\":" << quoteJson( encoding ? "batch-encode" : "batch-decode" )
+             << ",\"files\":" << results.size() - failed << ",\"failed\":" << failed
+             << ",\"raw_bytes\":" << rawTotal << ",\"packed_bytes\":" << packedTotal
+             << ",\"threads\":" << numThreads << ",\"seconds\":{\"total\":" << seconds << "}}";
 
-        // Other members
-        z -> value = 0;
+        std::cout << line.str() << std::endl;
 
-        // Insert new node into priority queue
-        PQ.insert( z );
+        return failed;
     }
 
-    // Safety check (should always be true)
-    // If PQ only has one node, set it as root
-    if( PQ.getTail() == 1 ) {
-        root = PQ.removeMin();
-    } else {
-        std::cout << "An error has occured when building the Huffman Tree" << std::endl;
-        std::cout << "Exiting ..." << std::endl;
-        exit( EXIT_FAILURE );
+    // Print out summary
+    std::cout << std::endl;
+    std::cout << "           Files processed:" << std::setw(10) << results.size() - failed << std::endl;
+    std::cout << "              Files failed:" << std::setw(10) << failed << std::endl;
+    std::cout << "    Size of original files:" << std::setw(10) << rawTotal
+                                               << std::setw(6)  << "bytes" << std::endl;
+    std::cout << "  Size of compressed files:" << std::setw(10) << packedTotal
+                                               << std::setw(6)  << "bytes" << std::endl;
+
+    if( rawTotal > 0 ) {
+        std::cout << "         Compression ratio:" << std::setw(10) << (double) packedTotal / (double) rawTotal << std::endl;
     }
+
+    std::cout << "              Elapsed time:" << std::setw(10) << std::fixed << std::setprecision(3) << seconds
+                                               << std::setw(8)  << "seconds" << std::endl;
+
+    return failed;
 }
 
 /** 
- * encode()
+ * encodeBatchFile()
  *
- * Creates encoded file with header information
- * for decoding
+ * Encodes one file of a batch on the calling worker.
+ * Output up to BATCH_BUFFER_LIMIT is built in the
+ * worker's buffer and written in one call, larger
+ * output is mapped as encode() does. Sets the error
+ * and returns false instead of exiting
  */
-void HuffmanTree::encode( std::string filename, std::ifstream &input ) {
+bool HuffmanTree::encodeBatchFile( BatchResult &result, BatchBuffers &buffers, bool adaptive ) {
     // Function variables
-    int  inputByte, outputByte, enPad;
-    char c;
+    MappedFile   input;
+    CodecOptions options = getCodecOptions();
+    CodecStatus  status;
+    size_t       pos     = result.filename.find( ".txt" );
+    size_t       written = 0;
 
-    // Rewind input file
-    input.clear();
-    input.seekg( 0, std::ios::beg );
+    std::chrono::steady_clock::time_point flush;
 
-    // Prepare output filename
-    int pos = filename.find( ".txt" );
-    std::string outputFilename = filename.substr( 0, pos ) + ".huf";
-    std::cout << "  Encoded file is called " << outputFilename << std::endl;
+    // Files run in parallel, so each one codes on its own worker
+    options.numThreads = 1;
 
-    // Open output file
-    std::ofstream output;
-    output.open( outputFilename.c_str(), std::ios::out | std::ios::trunc );
+    if( pos == std::string::npos ) {
+        result.error = "must have .txt extension";
+        return false;
+    }
 
-    // Check if output file is ready for writing
-    if( !output.good() ) {
-        std::cout << "  Error opening output file" << std::endl;
-        std::cout << "  Exiting..." << std::endl;
+    std::string outputFilename = result.filename.substr( 0, pos ) + ".huf";
+
+    if( !input.openRead( result.filename ) ) {
+        result.error = "cannot open file";
+        return false;
     }
 
-    // Define BitIO writer object
-    BitIO writer( output );
+    result.rawSize = input.getSize();
 
-    // Write number of symbols to output file
-    output << (unsigned char) frequencies.size();
+    if( adaptive ) {
+        int output = open( outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
 
-    // Initialise and add a char (1 byte) to the counter
-    outputByte = 8;
+        if( output < 0 ) {
+            result.error = "cannot create output file";
+            return false;
+        }
+
+        bool ok = writeAdaptiveFile( input.getData(), input.getSize(), output, buffers.chunk, written );
 
-    // Write Huffman Tree to output file
-    printHuffmanTree( writer );
+        if( close( output ) != 0 || !ok ) {
+            result.error = "error writing output file";
+            return false;
+        }
 
-    // Update output counter with size of Huffman Tree output
-    outputByte += 10 * frequencies.size() - 1;
+        result.packedSize = written;
 
-    // Initiate input file byte counter
-    inputByte = 0;
+        return true;
+    }
 
-    // Write codes to file
-    // Grab each character
-    while( input.get( c ) ) {
-        // Update byte counter of input file
-        inputByte++;
+    size_t bound = Codec::compressBound( input.getSize(), blockSize );
 
-        // Cache length of code
-        int codeLength = codes[c].length();
+    if( bound <= BATCH_BUFFER_LIMIT ) {
+        if( buffers.output.size() < bound ) {
+            buffers.output.resize( bound );
+        }
 
-        // Add length of code to output counter
-        outputByte += codeLength;
+        status = Codec::compress( input.getData(), input.getSize(), buffers.output.data(), bound, written, options, &result.stats );
 
-        // Write code to file char by char
-        for( int i = 0; i < codeLength; i++ ) {
-            if( codes[c][i] == '0' ) {
-                writer.writeBit( (char) 0 );
-            } else if( codes[c][i] == '1' ) {
-                writer.writeBit( (char) 1 );
-            }
+        if( status != CODEC_OK ) {
+            result.error = Codec::describe( status );
+            return false;
         }
-    }
 
-    // Check if buffer needs padding
-    enPad = writer.pad();
+        flush = std::chrono::steady_clock::now();
+
+        if( !writeFile( outputFilename, buffers.output.data(), written ) ) {
+            result.error = "error writing output file";
+            return false;
+        }
+    } else {
+        MappedFile output;
 
-    // Write padding information
-    writer.writeSymbol( (char) enPad );
+        if( !output.create( outputFilename, bound ) ) {
+            result.error = "cannot create output file";
+            return false;
+        }
 
-    // Update output counter with padding size and extra byte of data
-    outputByte += enPad + 8;
+        status = Codec::compress( input.getData(), input.getSize(), output.getData(), bound, written, options, &result.stats );
 
-    // Divide number of bits in output file by 8 to get bytes
-    //   Always divisible by 8 because of padding
-    outputByte /= 8;
+        if( status != CODEC_OK ) {
+            result.error = Codec::describe( status );
+            return false;
+        }
 
-    //std::cout << "padding = " << enPad << std::endl;
+        flush = std::chrono::steady_clock::now();
 
-    // Print out compression data
-    std::cout << std::endl;
-    std::cout << "    Size of original file:" << std::setw(10) << inputByte  
-                                              << std::setw(6)  << "bytes" << std::endl;
-    std::cout << "  Size of compressed file:" << std::setw(10) << outputByte 
-                                              << std::setw(6)  << "bytes" << std::endl;
-    std::cout << "        Compression ratio:" << std::setw(10) << (double) outputByte / (double) inputByte << std::endl;
+        if( !output.finish( written ) ) {
+            result.error = "error writing output file";
+            return false;
+        }
+    }
 
-    // Close files
-    input.close();
-    output.close();
+    result.packedSize          = written;
+    result.stats.flushSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - flush ).count();
+
+    return true;
 }
 
 /** 
- * decode()
+ * decodeBatchFile()
  *
- * Decodes encoded file
- * Read header information first to reconstruct Huffman Tree
+ * Decodes one file of a batch on the calling worker,
+ * through the worker's buffer up to BATCH_BUFFER_LIMIT
+ * and a mapped output beyond it. Sets the error and
+ * returns false instead of exiting
  */
-void HuffmanTree::decode( std::string filename, std::ifstream &input ) {
+bool HuffmanTree::decodeBatchFile( BatchResult &result, BatchBuffers &buffers ) {
     // Function variables
-    int           numChars, pos, last, enPad, readNumBits, flag = 0;
-    char          c;
-    unsigned char bit;
-
-    // Move file pointer to last byte
-    input.seekg( -1, std::ios::end );
+    MappedFile         input;
+    CodecOptions       options = getCodecOptions();
+    CodecStatus        status;
+    unsigned long long size;
+    size_t             pos = result.filename.find( ".huf" );
+    size_t             written;
 
-    // Cache position of file pointer
-    last = input.tellg();
-    
-    // Get size of padding
-    enPad = input.get();
-    //std::cout << "Padding = " << enPad << std::endl;
+    std::chrono::steady_clock::time_point flush;
 
-    // Clear file flags
-    input.clear();
+    options.numThreads = 1;
 
-    // Reset file pointer to start of file
-    input.seekg( 0, std::ios::beg );
+    if( pos == std::string::npos ) {
+        result.error = "must have .huf extension";
+        return false;
+    }
 
-    // First get number of symbols
-    numChars = input.get();
+    std::string outputFilename = result.filename.substr( 0, pos ) + DECODED_SUFFIX;
 
-    // Create BitIO reader object
-    BitIO reader( input );
+    if( !input.openRead( result.filename ) ) {
+        result.error = "cannot open file";
+        return false;
+    }
 
-    // Read in numChars number of symbols and build Huffman Tree
-    while( !input.eof() && numChars != 0 ) {
-        // Read one bit
-        bit = reader.readBit();
+    result.packedSize = input.getSize();
 
-        // Create the root node
-        root = new Node();
+    // Adaptive files are decoded a chunk at a time
+    if( input.getSize() >= AdaptiveHuffman::MAGIC_SIZE && AdaptiveHuffman::checkMagic( input.getData() ) ) {
+        int output = open( outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
 
-        // Initial decision
-        if( bit == 0x01 ) {
-            // There is only one node, the root node
-            root -> value = (int) reader.readSymbol();
+        if( output < 0 ) {
+            result.error = "cannot create output file";
+            return false;
+        }
 
-            // Ensure child nodes are properly defined
-            root -> left  = NULL;
-            root -> right = NULL;
+        bool  ok  = readAdaptiveFile( input.getData(), input.getSize(), output, buffers.chunk );
+        off_t end = lseek( output, 0, SEEK_CUR );
 
-            // Decrement number of characters counter
-            --numChars;
-        } else {
-            // There is more than one node, recurse left then right
-            root -> left  = decodeHuffmanTree( reader, numChars );
-            root -> right = decodeHuffmanTree( reader, numChars );
+        if( close( output ) != 0 || !ok ) {
+            result.error = "corrupt or truncated file";
+            return false;
         }
-    }
 
-    // Prepare output filename
-    pos = filename.find( ".huf" );
-    std::string outputFilename = filename.substr( 0, pos ) + ".decoded.txt";
-    std::cout << "  Beginning decoding process ..." << std::endl;
+        result.rawSize = end;
 
-    // Open output file
-    std::ofstream output;
-    output.open( outputFilename.c_str(), std::ios::out | std::ios::trunc );
+        return true;
+    }
 
-    // Check if output file is ready for writing
-    if( !output.good() ) {
-        std::cout << "  Error opening output file" << std::endl;
-        std::cout << "  Exiting..." << std::endl;
+    if( Codec::decompressedSize( input.getData(), input.getSize(), size ) != CODEC_OK ) {
+        result.error = "not a supported encoded file";
+        return false;
     }
 
-    // Initiate at root node
-    Node *current = root;
+    result.rawSize = size;
 
-    // Write out bits
-    while( input.tellg() < last ) {
-        // Grab next bit in file
-        bit = reader.readBit();
+    if( size <= BATCH_BUFFER_LIMIT ) {
+        if( buffers.output.size() < size ) {
+            buffers.output.resize( size );
+        }
 
-        // Traverse down Huffman Tree
-        current = ( ( bit == 0x00 ) ? current -> left : current -> right );
+        status = Codec::decompress( input.getData(), input.getSize(), buffers.output.data(), size, written, options );
+        flush  = std::chrono::steady_clock::now();
 
-        // Check if next node is a leaf node
-        if( current -> left == NULL || current -> right == NULL ) {
-            // Write to file the previous symbol
-            // if not the first pass of while loop
-            if(flag) output << c;
+        if( status == CODEC_OK && !writeFile( outputFilename, buffers.output.data(), written ) ) {
+            result.error = "error writing output file";
+            return false;
+        }
+    } else {
+        MappedFile output;
 
-            // Update symbol
-            c = (char) (current -> value);
+        if( !output.create( outputFilename, size ) ) {
+            result.error = "cannot create output file";
+            return false;
+        }
 
-            // Set write flag
-            flag = 1;
+        status = Codec::decompress( input.getData(), input.getSize(), output.getData(), size, written, options );
+        flush  = std::chrono::steady_clock::now();
 
-            // Reset current node to root node
-            current = root;
+        if( status == CODEC_OK && !output.finish( size ) ) {
+            result.error = "error writing output file";
+            return false;
         }
     }
 
-    // Write out last character in previous section
-    output << c;
+    if( status != CODEC_OK ) {
+        result.error = Codec::describe( status );
+        return false;
+    }
+
+    result.stats.flushSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - flush ).count();
 
-    // Calculate how many bits to read from last byte
-    readNumBits = ( enPad == 0 ) ? 8 : ( 8 - enPad );
+    return true;
+}
 
-    // Read last byte
-    for( int i = 0; i < readNumBits; i++ ) {
-        // Grab next bit in file
-        bit = reader.readBit();
+/** 
+ * isDirectory()
+ *
+ * Returns true if path names a directory
+ */
+bool HuffmanTree::isDirectory( std::string path ) {
+    struct stat info;
 
-        // Traverse down Huffman Tree
-        current = ( ( bit == 0x00 ) ? current -> left : current -> right );
+    return stat( path.c_str(), &info ) == 0 && S_ISDIR( info.st_mode );
+}
 
-        // Check if next node is a leaf node
-        if( current -> left == NULL || current -> right == NULL ) {
-            // Update symbol
-            c = (char) (current -> value);
+/** 
+ * listFiles()
+ *
+ * Adds path to files, or if it is a directory every
+ * file below it ending in extension, in name order.
+ * Decoded copies written by an earlier run are left out
+ */
+void HuffmanTree::listFiles( std::string path, std::string extension, std::vector<std::string> &files ) {
+    // Function variables
+    std::vector<std::string> names;
+    DIR                     *dir;
+    struct dirent           *entry;
+
+    // Plain files are checked when they are coded
+    if( !isDirectory( path ) || ( dir = opendir( path.c_str() ) ) == NULL ) {
+        files.push_back( path );
+        return;
+    }
 
-            // Write to file the symbol
-            output << c;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        std::string name = entry -> d_name;
 
-            // Reset current node to root node
-            current = root;
+        if( name != "." && name != ".." ) {
+            names.push_back( name );
         }
     }
 
-    // Close files
-    input.close();
-    output.close();
+    closedir( dir );
 
-    // Ending declaration
-    std::cout << "  Finished decoding ..." << std::endl;
-    std::cout << "  Decoded file is called " << outputFilename << std::endl;
+    std::sort( names.begin(), names.end() );
+
+    for( size_t i = 0; i < names.size(); i++ ) {
+        std::string child = path + "/" + names[i];
+
+        if( isDirectory( child ) ) {
+            listFiles( child, extension, files );
+        } else if( endsWith( child, extension ) && !endsWith( child, DECODED_SUFFIX ) ) {
+            files.push_back( child );
+        }
+    }
 }
 
 /** 
- * printFrequencies()
+ * readManifest()
  *
- * Prints frequency table to terminal
+ * Adds each non-empty line of a file list, or of
+ * standard input for -, to files. Returns false
+ * if the list cannot be opened
  */
-void HuffmanTree::printFrequencies() {
-    std::cout << std::endl;
-    std::cout << "  Finished counting frequencies. Here are the results:" << std::endl;
+bool HuffmanTree::readManifest( std::string filename, std::vector<std::string> &files ) {
+    std::ifstream list;
+    std::istream *input = &std::cin;
+    std::string   line;
 
-    std::tr1::unordered_map< int, int >::iterator it;
+    if( filename != "-" ) {
+        list.open( filename.c_str() );
 
-    for( it = frequencies.begin(); it != frequencies.end(); it++ ) {
-        // Print out key
-        if( it -> first == 10 ) {
-            std::cout << std::setw(5) << "\\n";
-        } else {
-            std::cout << std::setw(5) << (char) ( it -> first );
+        if( !list.is_open() ) {
+            return false;
         }
 
-        // Print out value
-        std::cout << std::setw(5) << it -> second << std::endl;
+        input = &list;
+    }
+
+    while( std::getline( *input, line ) ) {
+        // Tolerate lists written on Windows
+        if( !line.empty() && line[line.size() - 1] == '\r' ) {
+            line.erase( line.size() - 1 );
+        }
+
+        if( !line.empty() ) {
+            files.push_back( line );
+        }
     }
+
+    return true;
 }
 
 /** 
- * printPrefix()
+ * writeFile()
  *
- * Overload prefix print function
+ * Creates or truncates a file and writes data
+ * to it. Returns false on error
  */
-void HuffmanTree::printPrefix() {
-    // String to store code of symbol
-    std::string code = "";
+bool HuffmanTree::writeFile( std::string filename, const unsigned char *data, size_t size ) {
+    int  fd = open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    bool ok;
 
-    std::cout << "  Prefix codes:" << std::endl;
+    if( fd < 0 ) {
+        return false;
+    }
 
-    // Start printing at root node
-    printPrefix( root, code );
+    ok = writeFully( fd, data, size );
+
+    return close( fd ) == 0 && ok;
 }
 
 /** 
- * printPrefix()
+ * readFully()
  *
- * Recursively prints prefix codes to terminal
+ * Reads from a file descriptor until size bytes
+ * arrive or the input ends. Returns bytes read
  */
-void HuffmanTree::printPrefix( Node *node, std::string code) {
-    if( node -> left == NULL || node -> right == NULL ) {
-        // Print symbol and code to terminal
-        if( node -> value == 10 ) {
-            std::cout << std::setw(5)  << "\\n";
-        } else if( node -> value == 0 ) {
-            std::cout << std::setw(5)  << " ";
-        } else {
-            std::cout << std::setw(5)  << (char) node -> value;
-        }        
+size_t HuffmanTree::readFully( int fd, unsigned char *buffer, size_t size ) {
+    size_t total = 0;
 
-        std::cout << std::setw(20) << code << std::endl;
+    while( total < size ) {
+        ssize_t n = read( fd, buffer + total, size - total );
 
-        // Add symbol and code to code table
-        codes[node -> value] = code;
-    } else {
-        printPrefix( node -> left, code + "0" );
-        printPrefix( node -> right, code + "1" );
+        if( n < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if( n <= 0 ) {
+            break;
+        }
+
+        total += n;
     }
+
+    return total;
 }
 
 /** 
- * printHuffmanTree()
+ * writeFully()
  *
- * Overload print function for Huffman Tree
+ * Writes all bytes to a file descriptor.
+ * Returns false on error
  */
-void HuffmanTree::printHuffmanTree( BitIO &writer ) {
-    // Start printing at root node
-    printHuffmanTree( root, writer );
+bool HuffmanTree::writeFully( int fd, const unsigned char *buffer, size_t size ) {
+    size_t total = 0;
+
+    while( total < size ) {
+        ssize_t n = write( fd, buffer + total, size - total );
+
+        if( n < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if( n <= 0 ) {
+            return false;
+        }
+
+        total += n;
+    }
+
+    return true;
 }
 
 /** 
- * printHuffmanTree()
+ * readVarint()
  *
- * Recursilvely prints Huffman Tree
+ * Reads a variable length integer from a pipe a
+ * byte at a time, so nothing past it is consumed.
+ * Returns false at end of input or if malformed
  */
-void HuffmanTree::printHuffmanTree( Node *node, BitIO &writer ) {
-    if( node -> left == NULL || node -> right == NULL ) {
-        // Write 1 and symbol to output filename
-        writer.writeBit( (char) 1 );
-        writer.writeSymbol( (char) ( node -> value ) );
-    } else {
-        // Write 0 to output file
-        writer.writeBit( (char) 0 );
+bool HuffmanTree::readVarint( int fd, unsigned long long &value ) {
+    unsigned char bytes[BlockCodec::MAX_VARINT_SIZE];
 
-        // Recurse down Huffman Tree
-        printHuffmanTree( node -> left, writer );
-        printHuffmanTree( node -> right, writer );
+    for( size_t n = 0; n < BlockCodec::MAX_VARINT_SIZE; n++ ) {
+        if( readFully( fd, bytes + n, 1 ) != 1 ) {
+            return false;
+        }
+
+        if( ( bytes[n] & 0x80 ) == 0 ) {
+            return BlockCodec::getVarint( bytes, n + 1, value ) == n + 1;
+        }
     }
+
+    return false;
 }
 
 /** 
- * decodeHuffmanTree()
+ * printFrequencies()
  *
- * Converts Huffman Tree string into actual Huffman Tree
+ * Prints frequency table to terminal
  */
-Node* HuffmanTree::decodeHuffmanTree( BitIO &reader, int &numChars ) {
-    // Function variables
-    char bit;
+void HuffmanTree::printFrequencies() {
+    std::cout << std::endl;
+    std::cout << "  Finished counting frequencies. Here are the results:" << std::endl;
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        if( builder.getFrequency( s ) == 0 ) {
+            continue;
+        }
+
+        // Print out key
+        if( s == 10 ) {
+            std::cout << std::setw(5) << "\\n";
+        } else {
+            std::cout << std::setw(5) << (char) s;
+        }
+
+        // Print out value
+        std::cout << std::setw(5) << builder.getFrequency( s ) << std::endl;
+    }
+}
+
+/** 
+ * printPrefix()
+ *
+ * Prints canonical prefix codes to terminal
+ */
+void HuffmanTree::printPrefix() {
+    std::cout << "  Prefix codes:" << std::endl;
 
-    // Read next bit in file
-    bit = reader.readBit();
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        int length = getCodeTable().getLength( s );
 
-    // Create new node
-    Node *n = new Node();
+        if( length == 0 ) {
+            continue;
+        }
 
-    // If bit is 1, we have a leaf node
-    if( bit == 0x01 ) {
-        // Set symbol
-        n -> value = (int) reader.readSymbol();
+        // Spell out code word most significant bit first
+        std::string code( length, '0' );
 
-        // Set child nodes
-        n -> left  = NULL;
-        n -> right = NULL;
+        for( int i = 0; i < length; i++ ) {
+            if( ( getCodeTable().getCode( s ) >> ( length - 1 - i ) ) & 1 ) {
+                code[i] = '1';
+            }
+        }
 
-        // Other node attributes
-        n -> frequency = 0;
+        // Print symbol and code to terminal
+        if( s == 10 ) {
+            std::cout << std::setw(5)  << "\\n";
+        } else if( s == 0 ) {
+            std::cout << std::setw(5)  << " ";
+        } else {
+            std::cout << std::setw(5)  << (char) s;
+        }
 
-        // Decrement number of characters left
-        --numChars;
-    } else if( bit == 0x00 ) {
-        // Set node attributes
-        n -> value     = 0;
-        n -> frequency = 0;
+        std::cout << std::setw(20) << code << std::endl;
+    }
+}
 
-        // If bit is 0, decode left and right nodes
-        n -> left  = decodeHuffmanTree( reader, numChars );
-        n -> right = decodeHuffmanTree( reader, numChars );
+/** 
+ * printStats()
+ *
+ * Prints the results of coding one file as a single
+ * line of JSON. Block counts, code lengths and the
+ * time of each phase are added once blocks were coded.
+ * Phase times are summed over workers, so with several
+ * threads they can add up to more than the total
+ */
+void HuffmanTree::printStats( std::ostream &out, std::string mode, std::string filename,
+                              unsigned long long bytesIn, unsigned long long bytesOut, double seconds,
+                              const BlockStats &stats ) {
+    std::ostringstream line;
+
+    line << std::setprecision(6);
+    line << "{\"mode\":" << quoteJson( mode ) << ",\"file\":" << quoteJson( filename )
+         << ",\"bytes_in\":" << bytesIn << ",\"bytes_out\":" << bytesOut
+         << ",\"threads\":" << numThreads;
+
+    if( stats.numBlocks > 0 ) {
+        double symbols = ( stats.numSymbols > 0 ) ? (double) stats.numSymbols : 1.0;
+        double coded   = ( stats.numSymbols > stats.storedBytes ) ? (double) ( stats.numSymbols - stats.storedBytes ) : 1.0;
+
+        line << ",\"blocks\":" << stats.numBlocks
+             << ",\"stored_blocks\":" << stats.numStored
+             << ",\"stored_bytes\":" << stats.storedBytes
+             << ",\"reused_blocks\":" << stats.numReused
+             << ",\"context_blocks\":" << stats.numContext
+             << ",\"symbols\":" << stats.numSymbols
+             << ",\"distinct_symbols\":" << BlockCodec::countSeen( stats )
+             << ",\"max_code_length\":" << stats.maxLength
+             << ",\"avg_code_length\":" << stats.codedBits / coded
+             << ",\"entropy_bits_per_symbol\":" << stats.entropyBits / symbols
+             << ",\"achieved_bits_per_symbol\":" << 8.0 * bytesOut / symbols
+             << ",\"header_bytes\":" << ( stats.headerBits + 7 ) / 8
+             << ",\"seconds\":{\"histogram\":" << stats.histogramSeconds
+             << ",\"tree\":" << stats.treeSeconds
+             << ",\"header\":" << stats.headerSeconds
+             << ",\"encode\":" << stats.encodeSeconds
+             << ",\"flush\":" << stats.flushSeconds
+             << ",\"total\":" << seconds << "}}";
     } else {
-        std::cout << "Something bad is happening ..." << std::endl;
+        line << ",\"seconds\":{\"flush\":" << stats.flushSeconds
+             << ",\"total\":" << seconds << "}}";
+    }
+
+    out << line.str() << std::endl;
+}
+
+/** 
+ * quoteJson()
+ *
+ * Returns text in quotes with quotes, backslashes
+ * and control characters escaped
+ */
+std::string HuffmanTree::quoteJson( std::string text ) {
+    std::string quoted = "\"";
+
+    for( size_t i = 0; i < text.size(); i++ ) {
+        unsigned char c = text[i];
+
+        if( c == '"' || c == '\\' ) {
+            quoted += '\\';
+            quoted += c;
+        } else if( c < 0x20 ) {
+            char escape[8];
+            snprintf( escape, sizeof( escape ), "\\u%04x", c );
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
     }
 
-    // Set root node of Huffman Tree
-    return n;
-}
\ No newline at end of file
+    return quoted + "\"";
+}
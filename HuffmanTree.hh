@@ -12,14 +12,62 @@
 #include <cstdlib>
 #include <iomanip>
 #include <string>
-#include <tr1/unordered_map>
+#include <vector>
+#include <deque>
+#include <future>
+#include <atomic>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
 // Include definitions
 #include "Node.hh"
-#include "PriorityQueue.hh"
 #include "BitIO.hh"
+#include "CodeTable.hh"
+#include "TreeBuilder.hh"
+#include "DecodeTable.hh"
+#include "BlockCodec.hh"
+#include "ThreadPool.hh"
+#include "MappedFile.hh"
+#include "Codec.hh"
+#include "Kernels.hh"
+#include "AdaptiveHuffman.hh"
+
+/** 
+ * BatchResult
+ *
+ * Outcome of one file of a batch
+ */
+struct BatchResult {
+    std::string        filename;                                                            // Input file
+    bool               ok;                                                                  // Set once output is written
+    const char        *error;                                                               // Reason the file failed
+    unsigned long long rawSize;                                                             // Bytes of plain data
+    unsigned long long packedSize;                                                          // Bytes of encoded data
+    BlockStats         stats;                                                               // Block counts and phase times
+    double             seconds;                                                             // Wall time of the file
+};
+
+/** 
+ * BatchBuffers
+ *
+ * Memory a batch worker keeps from one file
+ * to the next instead of allocating it again
+ */
+struct BatchBuffers {
+    std::vector<unsigned char> output;                                                      // Whole encoded or decoded file
+    std::vector<unsigned char> chunk;                                                       // Adaptive chunk being coded
+};
+
+/** 
+ * StatsFormat
+ *
+ * How results are reported once a file is coded
+ */
+enum StatsFormat {
+    STATS_TEXT = 0,                                                                         // Aligned summary for reading
+    STATS_JSON                                                                              // One JSON object per file for monitoring
+};
 
 /** 
  * HuffmanTree.cc
@@ -29,29 +77,87 @@
 
 class HuffmanTree {
     public:
-        HuffmanTree() {}                                                                    // Default constructor
+        static const size_t COUNT_CHUNK  = 1 << 20;                                         // Bytes read per histogram pass
+        static const size_t ADAPTIVE_CHUNK = 1 << 14;                                       // Most bytes coded between adaptive flushes
+        static const size_t BATCH_BUFFER_LIMIT = 1 << 26;                                   // Largest batch output kept in memory, more is mapped
+        static const size_t RANGE_BUFFER_LIMIT = 1 << 26;                                   // Most of a range decoded before writing
+        static const char  *const DECODED_SUFFIX;                                           // Ending of decoded file names
+
+        HuffmanTree();                                                                      // Default constructor
         
         Node* getRoot();                                                                    // Returns root node
+        void  setBlockSize( size_t size );                                                  // Sets raw bytes per block
+        void  setNumThreads( int n );                                                       // Sets number of worker threads
+        void  setMaxCodeLength( int length );                                               // Sets code length limit, 0 for none
+        int   getMaxCodeLength();                                                           // Returns code length limit
+        void  setNumStreams( int n );                                                       // Sets bitstreams per block, 1 or 4
+        void  setSharedTable( SharedTable *table );                                         // Sets pre-trained table blocks may name
+        void  setContextModel( bool enabled );                                              // Lets blocks use order-1 context tables
+        void  setStatsFormat( StatsFormat format );                                         // Sets how results are reported
+        CodecOptions getCodecOptions();                                                     // Returns settings for the buffer API
+
+        CodeTable& getCodeTable();                                                          // Returns canonical codebook
+        unsigned long long getFrequency( int symbol );                                      // Returns count of a symbol
         void  countFrequencies( std::ifstream &inputFile );                                 // Build frequency table
-        void  buildPriorityQueue( PriorityQueue &PQ);                                       // Build priority queue
+        void  countFrequencies( const unsigned char *data, size_t size );                   // Add buffer to frequency table
+        void  setFrequencies( const unsigned long long *counts );                           // Replace frequency table
+        int   getNumSymbols();                                                              // Returns number of distinct symbols
         void  buildHuffmanTree();                                                           // Main Huffman Tree constructor
 
-        void  encode( std::string filename, std::ifstream &input );                         // Create encoded file
-        void  decode( std::string filename, std::ifstream &input );                         // Create decoded file
+        unsigned long long getCodedBits();                                                  // Bits needed with current codes
+        unsigned long long getUnlimitedBits();                                              // Bits needed without a length limit
+        double getEntropyBits();                                                            // Least bits any code could give
 
-        void  printFrequencies();                                                           // Prints table of frequencies
-        void  printPrefix();                                                                // Default prefix print function
-        void  printPrefix( Node *node, std::string code );                                  // Main prefix print function
+        void  encode( std::string filename, MappedFile &input );                            // Create encoded file
+        void  decode( std::string filename, MappedFile &input );                            // Create decoded file
+        void  encodeStream( int input, int output );                                        // Encode a pipe a block at a time
+        void  decodeStream( int input, int output );                                        // Decode a pipe a block at a time
+        bool  decodeRange( std::string filename, MappedFile &input,                         // Decode part of a file to a descriptor
+                           unsigned long long offset, unsigned long long length, int output );
+        void  encodeAdaptive( std::string filename, MappedFile &input );                    // Create adaptive encoded file
+        void  decodeAdaptive( std::string filename, MappedFile &input );                    // Decode adaptive file
+        void  encodeAdaptiveStream( int input, int output );                                // Encode a pipe as bytes arrive
+        void  decodeAdaptiveStream( int input, int output );                                // Decode a pipe after its magic
 
-        void  printHuffmanTree( BitIO &writer );                                            // Writes Huffman Tree to file
-        void  printHuffmanTree( Node *node, BitIO &writer );                                // Overload tree write function
+        int   encodeBatch( const std::vector<std::string> &files, bool adaptive );           // Encode files on a pool, returns failures
+        int   decodeBatch( const std::vector<std::string> &files );                         // Decode files on a pool, returns failures
+        static bool isDirectory( std::string path );                                        // Returns true if path is a directory
+        static void listFiles( std::string path, std::string extension,                     // Adds a file, or matching files under a directory
+                               std::vector<std::string> &files );
+        static bool readManifest( std::string filename, std::vector<std::string> &files );  // Adds one path per line, - for stdin
 
-        Node* decodeHuffmanTree( BitIO &reader, int &numChars );                            // Reads file bit by bit to construct Huffman Tree
+        void  printFrequencies();                                                           // Prints table of frequencies
+        void  printPrefix();                                                                // Prints canonical prefix codes
+        void  printStats( std::ostream &out, std::string mode, std::string filename,        // Prints one JSON object of results
+                          unsigned long long bytesIn, unsigned long long bytesOut, double seconds,
+                          const BlockStats &stats );
+        static std::string quoteJson( std::string text );                                   // Returns text as a JSON string
 
     private:
-        Node *root;
-        std::tr1::unordered_map< int, int > frequencies;                                    // Unordered map to hold frequencies
-        std::tr1::unordered_map< int, std::string > codes;                                  // Unordered map to hold prefix codes
+        TreeBuilder<unsigned char> builder;                                                 // Frequencies, tree and codes of the bytes
+        static size_t readFully( int fd, unsigned char *buffer, size_t size );              // Reads until size bytes or end of input
+        static bool   writeFully( int fd, const unsigned char *buffer, size_t size );       // Writes all bytes or fails
+        static bool   readVarint( int fd, unsigned long long &value );                      // Reads a container integer from a pipe
+        static bool   writeAdaptive( AdaptiveHuffman &coder,                                // Codes and writes one chunk and a flush
+                                     const unsigned char *data, size_t size, bool last,
+                                     std::vector<unsigned char> &buffer, int fd, size_t &written );
+        int   runBatch( const std::vector<std::string> &files, bool encoding, bool adaptive );  // Runs files on a pool and reports
+        bool  encodeBatchFile( BatchResult &result, BatchBuffers &buffers, bool adaptive ); // Encodes one file of a batch
+        bool  decodeBatchFile( BatchResult &result, BatchBuffers &buffers );                // Decodes one file of a batch
+        static bool   writeFile( std::string filename, const unsigned char *data, size_t size );   // Creates a file holding data
+        static bool   writeAdaptiveFile( const unsigned char *data, size_t size, int fd,    // Codes a whole adaptive file into fd
+                                         std::vector<unsigned char> &buffer, size_t &written );
+        static bool   readAdaptiveFile( const unsigned char *data, size_t size, int fd,     // Decodes a whole adaptive file into fd
+                                        std::vector<unsigned char> &decoded );
+
+        size_t    blockSize;                                                                // Raw bytes per block
+        int       numThreads;                                                               // Encoder and decoder worker threads
+        int       maxCodeLength;                                                            // Code length limit, 0 for none
+        int       numStreams;                                                               // Bitstreams per encoded block
+        SharedTable *sharedTable;                                                           // Pre-trained table, or NULL
+        bool      contextModel;                                                             // Blocks may use order-1 context tables
+        BlockStats totals;                                                                  // Sizes and timings summed over encoded blocks
+        StatsFormat statsFormat;                                                            // How results are reported
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,524 @@
+/** 
+ * Kernels.cc
+ *
+ * Class methods and implementation
+ * of the hot loops and their dispatch
+ */
+
+// Include header file
+#include "Kernels.hh"
+
+// Include libraries
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// Bytes counted into 32-bit lanes before they are merged
+static const size_t LANE_CHUNK = 1 << 30;
+
+// Bytes encoded by each set when timing them
+static const size_t CALIBRATION_BYTES = 1 << 16;
+
+// Set picked by timing, NULL until an input was large enough
+static std::atomic<const KernelSet *> calibrated( NULL );
+
+/** 
+ * histogramScalar()
+ *
+ * Reference histogram, one counter per byte
+ */
+static void histogramScalar( const unsigned char *data, size_t size, unsigned long long *frequencies ) {
+    for( size_t i = 0; i < size; i++ ) {
+        frequencies[data[i]]++;
+    }
+}
+
+/** 
+ * histogramLanes()
+ *
+ * Counts consecutive bytes into four separate tables,
+ * so repeated bytes do not stall on the previous
+ * increment of the same counter
+ */
+static void histogramLanes( const unsigned char *data, size_t size, unsigned long long *frequencies ) {
+    for( size_t start = 0; start < size; start += LANE_CHUNK ) {
+        unsigned int counts[4][256] = { { 0 } };
+        size_t       end = ( size - start < LANE_CHUNK ) ? size : start + LANE_CHUNK;
+        size_t       i   = start;
+
+        // Four bytes per iteration, one table each
+        for( ; i + 4 <= end; i += 4 ) {
+            counts[0][data[i]]++;
+            counts[1][data[i + 1]]++;
+            counts[2][data[i + 2]]++;
+            counts[3][data[i + 3]]++;
+        }
+
+        // Tail of buffer
+        for( ; i < end; i++ ) {
+            counts[0][data[i]]++;
+        }
+
+        // Merge tables
+        for( int s = 0; s < 256; s++ ) {
+            frequencies[s] += (unsigned long long) counts[0][s] + counts[1][s] + counts[2][s] + counts[3][s];
+        }
+    }
+}
+
+/** 
+ * encodeScalar()
+ *
+ * Reference encoder, one code written per symbol
+ */
+static void encodeScalar( const unsigned char *src, size_t count, size_t stride,
+                          const unsigned long long *codes, const int *lengths, int, BitIO &writer ) {
+    for( size_t i = 0; i < count; i++ ) {
+        unsigned char s = src[i * stride];
+
+        writer.writeBits( codes[s], lengths[s] );
+    }
+}
+
+/** 
+ * encodePairs()
+ *
+ * Joins the codes of two symbols into one write
+ * whenever both are sure to fit in a single call
+ */
+static void encodePairs( const unsigned char *src, size_t count, size_t stride,
+                         const unsigned long long *codes, const int *lengths, int maxLength, BitIO &writer ) {
+    size_t i = 0;
+
+    if( 2 * maxLength <= BitIO::MAX_BITS ) {
+        for( ; i + 2 <= count; i += 2 ) {
+            unsigned char a = src[i * stride];
+            unsigned char b = src[( i + 1 ) * stride];
+
+            writer.writeBits( ( codes[a] << lengths[b] ) | codes[b], lengths[a] + lengths[b] );
+        }
+    }
+
+    encodeScalar( src + i * stride, count - i, stride, codes, lengths, maxLength, writer );
+}
+
+/** 
+ * encodeQuads()
+ *
+ * Joins four codes into one write when they fit,
+ * otherwise writes them as two pairs
+ */
+static void encodeQuads( const unsigned char *src, size_t count, size_t stride,
+                         const unsigned long long *codes, const int *lengths, int maxLength, BitIO &writer ) {
+    size_t i = 0;
+
+    if( 2 * maxLength <= BitIO::MAX_BITS ) {
+        for( ; i + 4 <= count; i += 4 ) {
+            const unsigned char *p = src + i * stride;
+            unsigned char a = p[0], b = p[stride], c = p[2 * stride], d = p[3 * stride];
+
+            unsigned long long first  = ( codes[a] << lengths[b] ) | codes[b];
+            unsigned long long second = ( codes[c] << lengths[d] ) | codes[d];
+            int                x      = lengths[a] + lengths[b];
+            int                y      = lengths[c] + lengths[d];
+
+            if( x + y <= BitIO::MAX_BITS ) {
+                writer.writeBits( ( first << y ) | second, x + y );
+            } else {
+                writer.writeBits( first, x );
+                writer.writeBits( second, y );
+            }
+        }
+    }
+
+    encodePairs( src + i * stride, count - i, stride, codes, lengths, maxLength, writer );
+}
+
+#ifdef KERNELS_X86
+
+/** 
+ * loadIndices4()
+ *
+ * Widens the next four symbols to 64-bit lanes
+ */
+__attribute__(( target( "avx2" ) ))
+static inline __m256i loadIndices4( const unsigned char *src, size_t stride ) {
+    if( stride == 1 ) {
+        int packed;
+        memcpy( &packed, src, sizeof( packed ) );
+
+        return _mm256_cvtepu8_epi64( _mm_cvtsi32_si128( packed ) );
+    }
+
+    return _mm256_set_epi64x( src[3 * stride], src[2 * stride], src[stride], src[0] );
+}
+
+/** 
+ * encodeAVX2()
+ *
+ * Gathers the codes and lengths of four symbols and
+ * joins neighbours with variable shifts. The two pairs
+ * go out in one write when together they fit a call,
+ * which is nearly always, otherwise in two
+ */
+__attribute__(( target( "avx2" ) ))
+static void encodeAVX2( const unsigned char *src, size_t count, size_t stride,
+                        const unsigned long long *codes, const int *lengths, int maxLength, BitIO &writer ) {
+    size_t i = 0;
+
+    if( 2 * maxLength <= BitIO::MAX_BITS ) {
+        for( ; i + 4 <= count; i += 4 ) {
+            __m256i idx = loadIndices4( src + i * stride, stride );
+            __m256i c   = _mm256_i64gather_epi64( (const long long *) codes, idx, 8 );
+            __m256i l   = _mm256_cvtepu32_epi64( _mm256_i64gather_epi32( lengths, idx, 4 ) );
+
+            // Lanes 0 and 2 become c0 << l1 | c1 and c2 << l3 | c3
+            __m256i lHigh = _mm256_srli_si256( l, 8 );
+            __m256i pairs = _mm256_or_si256( _mm256_sllv_epi64( c, lHigh ), _mm256_srli_si256( c, 8 ) );
+            __m256i sums  = _mm256_add_epi64( l, lHigh );
+
+            unsigned long long first  = _mm256_extract_epi64( pairs, 0 );
+            unsigned long long second = _mm256_extract_epi64( pairs, 2 );
+            int                a      = (int) _mm256_extract_epi64( sums, 0 );
+            int                b      = (int) _mm256_extract_epi64( sums, 2 );
+
+            if( a + b <= BitIO::MAX_BITS ) {
+                writer.writeBits( ( first << b ) | second, a + b );
+            } else {
+                writer.writeBits( first, a );
+                writer.writeBits( second, b );
+            }
+        }
+    }
+
+    encodePairs( src + i * stride, count - i, stride, codes, lengths, maxLength, writer );
+}
+
+/** 
+ * encodeAVX512()
+ *
+ * Gathers eight symbols at once and joins them in two
+ * rounds of variable shifts into two groups of four.
+ * A group that does not fit one call is written as
+ * its two pairs
+ */
+__attribute__(( target( "avx512f" ) ))
+static void encodeAVX512( const unsigned char *src, size_t count, size_t stride,
+                          const unsigned long long *codes, const int *lengths, int maxLength, BitIO &writer ) {
+    size_t i = 0;
+
+    if( 2 * maxLength <= BitIO::MAX_BITS ) {
+        const __m512i odd  = _mm512_set_epi64( 0, 7, 0, 5, 0, 3, 0, 1 );
+        const __m512i next = _mm512_set_epi64( 0, 0, 0, 6, 0, 0, 0, 2 );
+
+        for( ; i + 8 <= count; i += 8 ) {
+            __m512i idx;
+
+            if( stride == 1 ) {
+                idx = _mm512_cvtepu8_epi64( _mm_loadl_epi64( (const __m128i *) ( src + i ) ) );
+            } else {
+                const unsigned char *p = src + i * stride;
+
+                idx = _mm512_set_epi64( p[7 * stride], p[6 * stride], p[5 * stride], p[4 * stride],
+                                        p[3 * stride], p[2 * stride], p[stride], p[0] );
+            }
+
+            __m512i c = _mm512_i64gather_epi64( idx, (const long long *) codes, 8 );
+            __m512i l = _mm512_cvtepu32_epi64( _mm512_i64gather_epi32( idx, lengths, 4 ) );
+
+            // Even lanes join with the odd lane after them
+            __m512i lOdd  = _mm512_permutexvar_epi64( odd, l );
+            __m512i pairs = _mm512_or_si512( _mm512_sllv_epi64( c, lOdd ), _mm512_permutexvar_epi64( odd, c ) );
+            __m512i sums  = _mm512_add_epi64( l, lOdd );
+
+            // Lanes 0 and 4 join with the pair two lanes on
+            __m512i sNext = _mm512_permutexvar_epi64( next, sums );
+            __m512i quads = _mm512_or_si512( _mm512_sllv_epi64( pairs, sNext ), _mm512_permutexvar_epi64( next, pairs ) );
+            __m512i total = _mm512_add_epi64( sums, sNext );
+
+            unsigned long long q[8], t[8], p[8], s[8];
+            _mm512_storeu_si512( q, quads );
+            _mm512_storeu_si512( t, total );
+
+            for( int g = 0; g < 8; g += 4 ) {
+                if( t[g] <= (unsigned long long) BitIO::MAX_BITS ) {
+                    writer.writeBits( q[g], (int) t[g] );
+                } else {
+                    _mm512_storeu_si512( p, pairs );
+                    _mm512_storeu_si512( s, sums );
+
+                    writer.writeBits( p[g],     (int) s[g] );
+                    writer.writeBits( p[g + 2], (int) s[g + 2] );
+                }
+            }
+        }
+    }
+
+    encodePairs( src + i * stride, count - i, stride, codes, lengths, maxLength, writer );
+}
+
+#endif
+
+// Every kernel set, reference first
+static const KernelSet SETS[] = {
+    { "scalar",   histogramScalar, encodeScalar },
+    { "portable", histogramLanes,  encodeQuads  },
+#ifdef KERNELS_X86
+    { "avx2",     histogramLanes,  encodeAVX2   },
+    { "avx512",   histogramLanes,  encodeAVX512 },
+#endif
+};
+
+/** 
+ * available()
+ *
+ * Fills sets with every kernel set this CPU can
+ * run, from the reference to the fastest, and
+ * returns how many there are
+ */
+int Kernels::available( const KernelSet **sets ) {
+    int n = 0;
+
+    sets[n++] = &SETS[0];
+    sets[n++] = &SETS[1];
+
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        sets[n++] = &SETS[2];
+    }
+
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "avx512f" ) ) {
+        sets[n++] = &SETS[3];
+    }
+#endif
+
+    return n;
+}
+
+/** 
+ * named()
+ *
+ * Returns the set named by HUF_KERNELS if this
+ * CPU runs it, otherwise NULL
+ */
+const KernelSet *Kernels::named() {
+    const KernelSet *sets[MAX_SETS];
+    int              n    = available( sets );
+    const char      *name = getenv( "HUF_KERNELS" );
+
+    for( int i = 0; name != NULL && i < n; i++ ) {
+        if( strcmp( name, sets[i] -> name ) == 0 ) {
+            return sets[i];
+        }
+    }
+
+    return NULL;
+}
+
+/** 
+ * select()
+ *
+ * Returns the set named by HUF_KERNELS if this CPU
+ * runs it. Otherwise every set the CPU supports
+ * encodes a small sample and the fastest is kept,
+ * since gathers are slow on some CPUs that have them
+ */
+const KernelSet &Kernels::select() {
+    const KernelSet *sets[MAX_SETS];
+    int              n = available( sets );
+
+    if( named() != NULL ) {
+        return *named();
+    }
+
+    // Text-like sample and code book, short codes for common bytes
+    std::vector<unsigned char> sample( CALIBRATION_BYTES ), out( CALIBRATION_BYTES * 2 + 16 );
+    int                        lengths[256];
+    unsigned long long         codes[256];
+
+    for( size_t i = 0; i < sample.size(); i++ ) {
+        sample[i] = (unsigned char) ( ( i * 2654435761U ) >> 27 );
+    }
+
+    for( int s = 0; s < 256; s++ ) {
+        lengths[s] = ( s < 32 ) ? 5 : 16;
+        codes[s]   = s & ( ( 1ULL << lengths[s] ) - 1 );
+    }
+
+    int    best     = 0;
+    double bestTime = 0;
+
+    for( int k = 0; k < n; k++ ) {
+        double fastest = 0;
+
+        for( int run = 0; run < 5; run++ ) {
+            BitIO writer( &out[0], out.size() );
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            sets[k] -> encode( &sample[0], sample.size(), 1, codes, lengths, 16, writer );
+            double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+            // First run only warms caches
+            fastest = ( run == 1 || elapsed < fastest ) ? elapsed : fastest;
+        }
+
+        // Reference set only counts if nothing else runs
+        if( k == 1 || ( k > 1 && fastest < bestTime ) ) {
+            best     = k;
+            bestTime = fastest;
+        }
+    }
+
+    return *sets[best];
+}
+
+/** 
+ * prepare()
+ *
+ * Times the sets the first time an input of at least
+ * CALIBRATION_THRESHOLD bytes is coded, so small
+ * inputs never pay for the timing runs
+ */
+void Kernels::prepare( unsigned long long size ) {
+    if( size >= CALIBRATION_THRESHOLD && calibrated.load() == NULL ) {
+        static const KernelSet &fastest = select();
+
+        calibrated = &fastest;
+    }
+}
+
+/** 
+ * get()
+ *
+ * Returns the set timed by prepare(), or before
+ * that the set named by HUF_KERNELS or the
+ * portable set
+ */
+const KernelSet &Kernels::get() {
+    const KernelSet *set = calibrated.load();
+
+    if( set == NULL ) {
+        static const KernelSet *preset = ( named() != NULL ) ? named() : &SETS[1];
+
+        set = preset;
+    }
+
+    return *set;
+}
+
+/** 
+ * scalar()
+ *
+ * Returns reference kernel set
+ */
+const KernelSet &Kernels::scalar() {
+    return SETS[0];
+}
+
+/** 
+ * crossCheck()
+ *
+ * Runs every available set on generated inputs and
+ * compares histograms and coded bytes against the
+ * reference set. Inputs cover short and long codes,
+ * every stride the block layouts use and lengths
+ * that leave a tail. Reports one line per set
+ */
+bool Kernels::crossCheck( std::ostream &report ) {
+    // Function variables
+    const KernelSet   *sets[MAX_SETS];
+    int                n  = available( sets );
+    bool               ok = true;
+    unsigned long long state = 0x2545F4914F6CDD1DULL;
+
+    // Skewed input so some codes are short and some long
+    std::vector<unsigned char> data( 100003 );
+
+    for( size_t i = 0; i < data.size(); i++ ) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        data[i] = (unsigned char) ( ( state & 0xFF ) * ( ( state >> 8 ) & 0xFF ) >> 8 );
+    }
+
+    // Code books: short codes only, codes up to 28 bits that pair but
+    // often overflow a group of four, then some too long for pairing
+    int                lengths[3][256];
+    unsigned long long codes[3][256];
+
+    for( int s = 0; s < 256; s++ ) {
+        lengths[0][s] = 1 + s % 12;
+        lengths[1][s] = ( s % 5 == 0 ) ? 20 + s % 9 : 1 + s % 12;
+        lengths[2][s] = ( s % 17 == 0 ) ? 40 : 1 + s % 20;
+
+        for( int b = 0; b < 3; b++ ) {
+            codes[b][s] = ( 0x9E3779B97F4A7C15ULL * ( s + 1 ) ) >> ( 64 - lengths[b][s] );
+        }
+    }
+
+    for( int k = 0; k < n; k++ ) {
+        bool same = true;
+
+        // Histogram over several lengths and misalignments
+        for( size_t size = 0; size < 200 && same; size += 7 ) {
+            unsigned long long expected[256] = { 0 }, actual[256] = { 0 };
+
+            scalar().histogram( &data[size % 13], size, expected );
+            sets[k] -> histogram( &data[size % 13], size, actual );
+
+            same = memcmp( expected, actual, sizeof( expected ) ) == 0;
+        }
+
+        if( same ) {
+            unsigned long long expected[256] = { 0 }, actual[256] = { 0 };
+
+            scalar().histogram( &data[0], data.size(), expected );
+            sets[k] -> histogram( &data[0], data.size(), actual );
+
+            same = memcmp( expected, actual, sizeof( expected ) ) == 0;
+        }
+
+        // Encoding with every code book, stride and a ragged count
+        for( int b = 0; b < 3 && same; b++ ) {
+            int maxLength = 0;
+
+            for( int s = 0; s < 256; s++ ) {
+                maxLength = ( lengths[b][s] > maxLength ) ? lengths[b][s] : maxLength;
+            }
+
+            for( size_t stride = 1; stride <= 4 && same; stride += 3 ) {
+                size_t count = ( data.size() - stride ) / stride;
+
+                std::vector<unsigned char> expected( count * 8 + 16 ), actual( count * 8 + 16 );
+                BitIO                      reference( &expected[0], expected.size() );
+                BitIO                      candidate( &actual[0], actual.size() );
+
+                scalar().encode( &data[1], count, stride, codes[b], lengths[b], maxLength, reference );
+                sets[k] -> encode( &data[1], count, stride, codes[b], lengths[b], maxLength, candidate );
+
+                reference.pad();
+                candidate.pad();
+
+                same = reference.getBytesWritten() == candidate.getBytesWritten() &&
+                       memcmp( &expected[0], &actual[0], reference.getBytesWritten() ) == 0;
+            }
+        }
+
+        report << "  Kernel set " << sets[k] -> name << ": " << ( same ? "matches reference" : "MISMATCH" ) << std::endl;
+
+        ok = ok && same;
+    }
+
+    return ok;
+}
@@ -0,0 +1,64 @@
+/** 
+ * Kernels.hh
+ *
+ * Class definitions
+ */
+
+#ifndef KERNELS_HH
+#define KERNELS_HH
+
+// Include libraries
+#include <cstddef>
+#include <iostream>
+
+// Include classes
+#include "BitIO.hh"
+
+// Adds the bytes of data to a table of 256 frequencies
+typedef void (*HistogramKernel)( const unsigned char *data, size_t size,
+                                 unsigned long long *frequencies );
+
+// Writes the codes of count symbols taken every stride bytes from src
+typedef void (*EncodeKernel)( const unsigned char *src, size_t count, size_t stride,
+                              const unsigned long long *codes, const int *lengths,
+                              int maxLength, BitIO &writer );
+
+/** 
+ * KernelSet
+ *
+ * One implementation of each hot loop
+ */
+struct KernelSet {
+    const char      *name;                                          // Name used in reports and HUF_KERNELS
+    HistogramKernel  histogram;                                     // Counts symbol frequencies
+    EncodeKernel     encode;                                        // Looks up and packs codes
+};
+
+/** 
+ * Kernels
+ *
+ * Chooses the fastest kernel set this CPU can run the
+ * first time a large input is coded, and uses the
+ * portable set until then. The scalar set is the
+ * reference every other set must match bit for bit.
+ * Setting HUF_KERNELS to a set name overrides the
+ * choice, which helps compare them
+ */
+class Kernels {
+    public:
+        static const int    MAX_SETS = 4;                           // Kernel sets compiled in
+        static const size_t CALIBRATION_THRESHOLD = 1 << 24;        // Input bytes worth timing the sets for
+
+        static void prepare( unsigned long long size );             // Times the sets once an input is large enough
+        static const KernelSet &get();                              // Returns set in use
+        static const KernelSet &scalar();                           // Returns reference set
+        static int  available( const KernelSet **sets );            // Lists sets this CPU runs, best last
+
+        static bool crossCheck( std::ostream &report );             // Checks every set against the reference
+
+    private:
+        static const KernelSet &select();                           // Picks set from CPU features
+        static const KernelSet *named();                            // Returns set named by HUF_KERNELS, or NULL
+};
+
+#endif
@@ -0,0 +1,170 @@
+/** 
+ * MappedFile.cc
+ *
+ * Class methods and implementation
+ * for memory-mapped file input and output
+ */
+
+// Include header file
+#include "MappedFile.hh"
+
+// Include libraries
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** 
+ * MappedFile()
+ *
+ * Default constructor
+ */
+MappedFile::MappedFile() {
+    fd   = -1;
+    data = NULL;
+    size = 0;
+}
+
+/** 
+ * ~MappedFile()
+ *
+ * Destructor
+ */
+MappedFile::~MappedFile() {
+    close();
+}
+
+/** 
+ * openRead()
+ *
+ * Maps a whole file read-only and tells the kernel it
+ * will be read front to back. An empty file has no
+ * mapping. Returns false if the file cannot be mapped
+ */
+bool MappedFile::openRead( std::string filename ) {
+    // Function variables
+    struct stat info;
+
+    close();
+
+    fd = open( filename.c_str(), O_RDONLY );
+
+    if( fd < 0 || fstat( fd, &info ) != 0 ) {
+        close();
+        return false;
+    }
+
+    size = info.st_size;
+
+    if( size == 0 ) {
+        return true;
+    }
+
+    void *map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    if( map == MAP_FAILED ) {
+        close();
+        return false;
+    }
+
+    data = (unsigned char *) map;
+
+    madvise( data, size, MADV_SEQUENTIAL );
+
+    return true;
+}
+
+/** 
+ * create()
+ *
+ * Creates or truncates a file, sizes it and maps it
+ * for writing. Returns false on failure
+ */
+bool MappedFile::create( std::string filename, size_t size ) {
+    close();
+
+    fd = open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+
+    if( fd < 0 || ftruncate( fd, size ) != 0 ) {
+        close();
+        return false;
+    }
+
+    this -> size = size;
+
+    if( size == 0 ) {
+        return true;
+    }
+
+    void *map = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if( map == MAP_FAILED ) {
+        close();
+        return false;
+    }
+
+    data = (unsigned char *) map;
+
+    return true;
+}
+
+/** 
+ * finish()
+ *
+ * Unmaps an output file and cuts it down to the
+ * number of bytes actually written
+ */
+bool MappedFile::finish( size_t size ) {
+    // Function variables
+    bool ok = true;
+
+    if( data != NULL ) {
+        munmap( data, this -> size );
+        data = NULL;
+    }
+
+    if( fd >= 0 && ftruncate( fd, size ) != 0 ) {
+        ok = false;
+    }
+
+    close();
+
+    return ok;
+}
+
+/** 
+ * close()
+ *
+ * Unmaps and closes the file
+ */
+void MappedFile::close() {
+    if( data != NULL ) {
+        munmap( data, size );
+    }
+
+    if( fd >= 0 ) {
+        ::close( fd );
+    }
+
+    fd   = -1;
+    data = NULL;
+    size = 0;
+}
+
+/** 
+ * getData()
+ *
+ * Returns start of mapping
+ */
+unsigned char* MappedFile::getData() {
+    return data;
+}
+
+/** 
+ * getSize()
+ *
+ * Returns length of mapping
+ */
+size_t MappedFile::getSize() {
+    return size;
+}
@@ -0,0 +1,42 @@
+/** 
+ * MappedFile.hh
+ *
+ * Class definitions
+ */
+
+#ifndef MAPPEDFILE_HH
+#define MAPPEDFILE_HH
+
+// Include libraries
+#include <string>
+#include <cstddef>
+
+/** 
+ * MappedFile
+ *
+ * A file mapped into memory, either read-only for input
+ * or read-write at a known size for output
+ */
+class MappedFile {
+    public:
+        MappedFile();                                               // Default constructor: nothing mapped
+        ~MappedFile();                                              // Destructor: unmaps and closes
+
+        bool openRead( std::string filename );                      // Maps existing file read-only
+        bool create( std::string filename, size_t size );           // Creates file of size bytes and maps it
+        bool finish( size_t size );                                 // Unmaps output and truncates it to size
+        void close();                                               // Unmaps and closes file
+
+        unsigned char *getData();                                   // Returns start of mapping
+        size_t         getSize();                                   // Returns length of mapping
+
+    private:
+        MappedFile( const MappedFile & );                           // Not copyable
+        MappedFile& operator=( const MappedFile & );
+
+        int            fd;                                          // File descriptor, -1 when closed
+        unsigned char *data;                                        // Start of mapping, NULL when empty
+        size_t         size;                                        // Length of mapping
+};
+
+#endif
@@ -7,45 +7,6 @@
 // Include header file
 #include "Node.hh"
 
-/** 
- * Node()
- *
- * Copy constructor
- */
-Node::Node( Node *n ) {
-    // Set members
-    value     = n -> value;
-    frequency = n -> frequency;
-
-    if( n -> left != NULL ) {
-        left = new Node();
-        *left = *( n -> left );
-    }
-
-    if( n -> right != NULL ) {
-        right = new Node();
-        *right = *( n -> right );
-    }
-}
-
-/** 
- * ~Node()
- *
- * Destructor deletes child pointers
- * if declared on construction
- */
-Node::~Node() {
-    // Delete left node
-    if( left != NULL ) {
-        delete left;
-    }
-
-    // Delete right node
-    if( right != NULL ) {
-        delete right;
-    }
-}
-
 /** 
  * print()
  *
@@ -56,13 +17,29 @@ void Node::print() {
     std::cout << std::setw(10) << "Value: "     << std::setw(5)  << value     << " "
               << std::setw(10) << "Frequency: " << std::setw(20) << frequency << " ";
 
-    if( left != NULL ) {
+    if( left >= 0 ) {
         std::cout << "LEFT ";
     }
 
-    if( right != NULL ) {
+    if( right >= 0 ) {
         std::cout << "RIGHT ";
     }
 
     std::cout << std::endl;
-}
\ No newline at end of file
+}
+
+/** 
+ * allocate()
+ *
+ * Hands out the next unused node,
+ * reset to an empty leaf
+ */
+int NodeArena::allocate() {
+    if( count == (int) nodes.size() ) {
+        return -1;
+    }
+
+    nodes[count] = Node();
+
+    return count++;
+}
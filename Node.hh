@@ -10,25 +10,53 @@
 // Include libraries
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
 /** 
  * Node
  *
  * Class definitions and methods
+ * Children are positions in the NodeArena
+ * holding the node, -1 marks a leaf
  */
 class Node {
     public:
-        Node() {}                   // Default constructor
-        Node( Node *n );            // Copy Constructor
-        ~Node();                    // Destructor
+        Node() : value( 0 ), frequency( 0 ), left( -1 ), right( -1 ) {}    // Default constructor: empty leaf
+
+        bool isLeaf() const { return left < 0 || right < 0; }
 
         void print();
 
         int value;
-        int frequency;
+        unsigned long long frequency;
         
-        Node *left;
-        Node *right;
+        int left;
+        int right;
+};
+
+/** 
+ * NodeArena
+ *
+ * Fixed block of nodes for one tree. A full binary
+ * tree over n symbols has at most 2n - 1 nodes, so the
+ * arena is sized once for its alphabet, never grows and
+ * is freed in one step
+ */
+class NodeArena {
+    public:
+        explicit NodeArena( int numSymbols = 256 )                  // Constructor: empty arena for an alphabet
+            : nodes( 2 * numSymbols - 1 ), count( 0 ) {}
+
+        int   allocate();                                           // Returns position of a fresh node, -1 if full
+        void  clear() { count = 0; }                                // Releases every node at once
+        int   size() const { return count; }                        // Returns number of nodes in use
+
+        Node&       operator[]( int i )       { return nodes[i]; }
+        const Node& operator[]( int i ) const { return nodes[i]; }
+
+    private:
+        std::vector<Node> nodes;                                    // Node storage
+        int  count;                                                 // Nodes handed out
 };
 
-#endif
\ No newline at end of file
+#endif
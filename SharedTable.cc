@@ -0,0 +1,183 @@
+/** 
+ * SharedTable.cc
+ *
+ * Class methods and implementation
+ * for pre-trained code tables
+ */
+
+// Include header file
+#include "SharedTable.hh"
+#include "TreeBuilder.hh"
+#include "BlockCodec.hh"
+
+// Include libraries
+#include <fstream>
+
+/** 
+ * SharedTable()
+ *
+ * Default constructor
+ */
+SharedTable::SharedTable() {
+    id    = 0;
+    ready = false;
+}
+
+/** 
+ * train()
+ *
+ * Counts the sample, plus one of every byte so
+ * each has a code, and keeps the resulting lengths.
+ * A limit of zero uses DEFAULT_MAX_LENGTH. Returns
+ * false if the codes could not be built
+ */
+bool SharedTable::train( const unsigned char *data, size_t size, int maxCodeLength ) {
+    // Function variables
+    TreeBuilder<unsigned char> tree;
+    unsigned char              alphabet[CodeTable::NUM_SYMBOLS];
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        alphabet[s] = (unsigned char) s;
+    }
+
+    tree.setMaxCodeLength( ( maxCodeLength > 0 ) ? maxCodeLength : DEFAULT_MAX_LENGTH );
+    tree.countFrequencies( data, size );
+    tree.countFrequencies( alphabet, CodeTable::NUM_SYMBOLS );
+
+    if( !tree.build() ) {
+        return false;
+    }
+
+    codeTable.clear();
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        codeTable.setLength( s, tree.getCodeTable().getLength( s ) );
+    }
+
+    return finish();
+}
+
+/** 
+ * save()
+ *
+ * Writes magic, ID and code lengths.
+ * Returns false if the file cannot be written
+ */
+bool SharedTable::save( std::string filename ) {
+    if( !ready ) {
+        return false;
+    }
+
+    std::vector<unsigned char> data( MAGIC_SIZE + ID_SIZE + CodeTable::MAX_HEADER_BYTES );
+
+    data[0] = 'H';
+    data[1] = 'U';
+    data[2] = 'T';
+    data[3] = VERSION;
+    BlockCodec::putWord( &data[MAGIC_SIZE], id );
+
+    BitIO writer( &data[MAGIC_SIZE + ID_SIZE], data.size() - MAGIC_SIZE - ID_SIZE );
+
+    if( !codeTable.write( writer ) ) {
+        return false;
+    }
+
+    writer.pad();
+
+    std::ofstream output( filename.c_str(), std::ios::binary );
+
+    output.write( (const char *) &data[0], MAGIC_SIZE + ID_SIZE + writer.getBytesWritten() );
+
+    return output.good();
+}
+
+/** 
+ * load()
+ *
+ * Reads a table file and rebuilds the codes.
+ * Returns false unless the file is a table whose
+ * lengths still match its ID
+ */
+bool SharedTable::load( std::string filename ) {
+    std::ifstream input( filename.c_str(), std::ios::binary );
+
+    std::vector<unsigned char> data( ( std::istreambuf_iterator<char>( input ) ),
+                                     std::istreambuf_iterator<char>() );
+
+    ready = false;
+
+    if( data.size() < MAGIC_SIZE + ID_SIZE ||
+        data[0] != 'H' || data[1] != 'U' || data[2] != 'T' || data[3] != VERSION ) {
+        return false;
+    }
+
+    const unsigned char *table = &data[MAGIC_SIZE + ID_SIZE];
+    BitIO                reader( table, data.size() - MAGIC_SIZE - ID_SIZE );
+
+    if( !codeTable.read( reader ) || codeTable.getNumSymbols() != CodeTable::NUM_SYMBOLS ) {
+        return false;
+    }
+
+    return finish() && id == BlockCodec::getWord( &data[MAGIC_SIZE] );
+}
+
+/** 
+ * isReady()
+ *
+ * Returns true once a table is trained or loaded
+ */
+bool SharedTable::isReady() {
+    return ready;
+}
+
+/** 
+ * getId()
+ *
+ * Returns ID of the table
+ */
+unsigned int SharedTable::getId() {
+    return id;
+}
+
+/** 
+ * getCodeTable()
+ *
+ * Returns code lengths and words
+ */
+CodeTable& SharedTable::getCodeTable() {
+    return codeTable;
+}
+
+/** 
+ * getDecodeTable()
+ *
+ * Returns lookup table, built once when the
+ * table was trained or loaded
+ */
+DecodeTable& SharedTable::getDecodeTable() {
+    return decodeTable;
+}
+
+/** 
+ * finish()
+ *
+ * Assigns canonical codes, builds the lookup table
+ * and hashes the lengths (FNV-1a) into the ID
+ */
+bool SharedTable::finish() {
+    if( !codeTable.assignCanonicalCodes() ) {
+        return false;
+    }
+
+    decodeTable.build( codeTable.getLengths(), codeTable.getCodes(), CodeTable::NUM_SYMBOLS );
+
+    id = 2166136261u;
+
+    for( int s = 0; s < CodeTable::NUM_SYMBOLS; s++ ) {
+        id = ( id ^ (unsigned int) codeTable.getLength( s ) ) * 16777619u;
+    }
+
+    ready = true;
+
+    return true;
+}
@@ -0,0 +1,59 @@
+/** 
+ * SharedTable.hh
+ *
+ * Class definitions
+ */
+
+#ifndef SHAREDTABLE_HH
+#define SHAREDTABLE_HH
+
+// Include libraries
+#include <string>
+#include <vector>
+
+// Include classes
+#include "CodeTable.hh"
+#include "DecodeTable.hh"
+
+/** 
+ * SharedTable
+ *
+ * A code table trained offline from a sample corpus and
+ * kept in its own file, so small blocks and messages can
+ * name it by ID instead of carrying a table of their own.
+ * Every byte gets a code, whether the sample held it or
+ * not. The ID is a hash of the code lengths, so a message
+ * is never decoded with a different table by mistake.
+ *
+ *   file          "HUT", version, ID (4 bytes, little-endian),
+ *                 code lengths as written by CodeTable
+ */
+class SharedTable {
+    public:
+        static const int    VERSION            = 1;                 // Table file version written
+        static const size_t MAGIC_SIZE         = 4;                 // Bytes of magic and version
+        static const size_t ID_SIZE            = 4;                 // Bytes of table ID
+        static const int    DEFAULT_MAX_LENGTH = 16;                // Code length limit unless configured
+
+        SharedTable();                                              // Default constructor: no table
+
+        bool train( const unsigned char *data, size_t size,         // Builds codes from a sample
+                    int maxCodeLength );
+        bool save( std::string filename );                          // Writes table file
+        bool load( std::string filename );                          // Reads table file
+
+        bool         isReady();                                     // Returns true once trained or loaded
+        unsigned int getId();                                       // Returns ID carried by coded data
+        CodeTable&   getCodeTable();                                // Returns code lengths and words
+        DecodeTable& getDecodeTable();                              // Returns lookup table built once
+
+    private:
+        bool finish();                                              // Assigns codes, builds lookup and ID
+
+        CodeTable    codeTable;                                     // Code of every byte
+        DecodeTable  decodeTable;                                   // Lookup table for the codes
+        unsigned int id;                                            // Hash of the code lengths
+        bool         ready;                                         // Set once codes are assigned
+};
+
+#endif
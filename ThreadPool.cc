@@ -0,0 +1,181 @@
+/** 
+ * ThreadPool.cc
+ *
+ * Class methods and implementation
+ * for running tasks on worker threads
+ */
+
+// Include header file
+#include "ThreadPool.hh"
+
+// Worker a thread belongs to, and its pool
+static thread_local ThreadPool *currentPool = NULL;
+static thread_local int         currentId   = -1;
+
+/** 
+ * ThreadPool()
+ *
+ * Starts numThreads workers, at least one
+ */
+ThreadPool::ThreadPool( int numThreads ) : queued( 0 ), next( 0 ) {
+    stopping = false;
+
+    if( numThreads < 1 ) {
+        numThreads = 1;
+    }
+
+    // Queues exist before any worker looks at them
+    for( int i = 0; i < numThreads; i++ ) {
+        queues.push_back( std::unique_ptr<WorkQueue>( new WorkQueue() ) );
+    }
+
+    for( int i = 0; i < numThreads; i++ ) {
+        workers.push_back( std::thread( &ThreadPool::worker, this, i ) );
+    }
+}
+
+/** 
+ * ~ThreadPool()
+ *
+ * Lets workers finish queued tasks
+ * then joins them
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stopping = true;
+    }
+
+    ready.notify_all();
+
+    for( size_t i = 0; i < workers.size(); i++ ) {
+        workers[i].join();
+    }
+}
+
+/** 
+ * getNumThreads()
+ *
+ * Returns number of worker threads
+ */
+int ThreadPool::getNumThreads() {
+    return workers.size();
+}
+
+/** 
+ * defaultThreads()
+ *
+ * Returns number of hardware threads,
+ * or one if it cannot be determined
+ */
+int ThreadPool::defaultThreads() {
+    int n = std::thread::hardware_concurrency();
+
+    return ( n > 0 ) ? n : 1;
+}
+
+/** 
+ * currentWorker()
+ *
+ * Returns number of the worker running the caller,
+ * so a task can keep state per worker, or -1 when
+ * called outside any pool
+ */
+int ThreadPool::currentWorker() {
+    return currentId;
+}
+
+/** 
+ * submit()
+ *
+ * Queues a task on the submitting worker's own queue,
+ * or round-robin when submitted from outside the pool
+ */
+std::future<void> ThreadPool::submit( std::function<void()> task ) {
+    std::packaged_task<void()> job( task );
+    std::future<void>          done = job.get_future();
+    size_t                     id;
+
+    if( currentPool == this ) {
+        id = currentId;
+    } else {
+        id = next++ % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard( queues[id] -> lock );
+        queues[id] -> tasks.push_back( std::move( job ) );
+        queued++;
+    }
+
+    // Taking the lock orders this with a worker about to sleep
+    {
+        std::lock_guard<std::mutex> guard( lock );
+    }
+
+    ready.notify_one();
+
+    return done;
+}
+
+/** 
+ * take()
+ *
+ * Pops the oldest task of a worker's own queue, or
+ * steals the newest task of the next busy worker.
+ * Returns false if every queue is empty
+ */
+bool ThreadPool::take( int id, std::packaged_task<void()> &task ) {
+    for( size_t i = 0; i < queues.size(); i++ ) {
+        WorkQueue                  &queue = *queues[( id + i ) % queues.size()];
+        std::lock_guard<std::mutex> guard( queue.lock );
+
+        if( queue.tasks.empty() ) {
+            continue;
+        }
+
+        if( i == 0 ) {
+            task = std::move( queue.tasks.front() );
+            queue.tasks.pop_front();
+        } else {
+            task = std::move( queue.tasks.back() );
+            queue.tasks.pop_back();
+        }
+
+        queued--;
+
+        return true;
+    }
+
+    return false;
+}
+
+/** 
+ * worker()
+ *
+ * Runs tasks until the pool stops
+ * and every queue is empty
+ */
+void ThreadPool::worker( int id ) {
+    currentPool = this;
+    currentId   = id;
+
+    while( true ) {
+        std::packaged_task<void()> job;
+
+        if( take( id, job ) ) {
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard( lock );
+
+        while( !stopping && queued == 0 ) {
+            ready.wait( guard );
+        }
+
+        if( stopping && queued == 0 ) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/** 
+ * ThreadPool.hh
+ *
+ * Class definitions
+ */
+
+#ifndef THREADPOOL_HH
+#define THREADPOOL_HH
+
+// Include libraries
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+/** 
+ * WorkQueue
+ *
+ * Tasks waiting for one worker
+ */
+struct WorkQueue {
+    std::deque< std::packaged_task<void()> > tasks;                 // Queued tasks, oldest first
+    std::mutex                               lock;                  // Guards tasks
+};
+
+/** 
+ * ThreadPool
+ *
+ * Fixed set of worker threads, each with its own queue.
+ * Tasks are dealt round-robin, or onto the submitting
+ * worker's own queue. A worker runs its own tasks oldest
+ * first and, once they run out, steals the newest task
+ * of another worker, so uneven tasks still keep every
+ * worker busy
+ */
+class ThreadPool {
+    public:
+        ThreadPool( int numThreads );                               // Main constructor: starts workers
+        ~ThreadPool();                                              // Destructor: finishes queues and joins workers
+
+        int getNumThreads();                                        // Returns number of workers
+
+        std::future<void> submit( std::function<void()> task );     // Queues a task, future is ready once it ran
+
+        static int defaultThreads();                                // Returns number of hardware threads
+        static int currentWorker();                                 // Returns worker running the caller, -1 if none
+
+    private:
+        void worker( int id );                                      // Worker loop
+        bool take( int id, std::packaged_task<void()> &task );      // Pops own task or steals one
+
+        std::vector<std::thread>                 workers;           // Worker threads
+        std::vector< std::unique_ptr<WorkQueue> > queues;           // One queue per worker
+        std::atomic<size_t>                      queued;            // Tasks in all queues
+        std::atomic<size_t>                      next;              // Queue the next outside task goes to
+        std::mutex                               lock;              // Guards sleeping and stopping
+        std::condition_variable                  ready;             // Signalled when a task is queued
+        bool                                     stopping;          // Set when pool is shutting down
+};
+
+#endif
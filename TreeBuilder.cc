@@ -0,0 +1,397 @@
+/** 
+ * TreeBuilder.cc
+ *
+ * Class methods and implementation
+ * for building Huffman codes over any
+ * symbol width
+ */
+
+// Include header file
+#include "TreeBuilder.hh"
+#include "Kernels.hh"
+
+// Include libraries
+#include <algorithm>
+#include <cmath>
+
+/** 
+ * TreeBuilder()
+ *
+ * Default constructor
+ */
+template<typename Symbol>
+TreeBuilder<Symbol>::TreeBuilder() : nodes( NUM_SYMBOLS ), frequencies( NUM_SYMBOLS, 0 ) {
+    root          = -1;
+    maxCodeLength = 0;
+    unlimitedBits = 0;
+}
+
+/** 
+ * setMaxCodeLength()
+ *
+ * Sets longest code build() may produce,
+ * zero for no limit of our own
+ */
+template<typename Symbol>
+void TreeBuilder<Symbol>::setMaxCodeLength( int length ) {
+    if( length < 0 || length > BasicCodeTable<Symbol>::MAX_CODE_LENGTH ) {
+        length = 0;
+    }
+
+    maxCodeLength = length;
+}
+
+/** 
+ * getMaxCodeLength()
+ *
+ * Returns code length limit, zero if none
+ */
+template<typename Symbol>
+int TreeBuilder<Symbol>::getMaxCodeLength() {
+    return maxCodeLength;
+}
+
+/** 
+ * countFrequencies()
+ *
+ * Adds the symbols of a buffer to the frequency table
+ */
+template<typename Symbol>
+void TreeBuilder<Symbol>::countFrequencies( const Symbol *data, size_t size ) {
+    for( size_t i = 0; i < size; i++ ) {
+        frequencies[data[i]]++;
+    }
+}
+
+/** 
+ * countFrequencies()
+ *
+ * Bytes are counted with the histogram
+ * kernel chosen for this CPU
+ */
+template<>
+void TreeBuilder<unsigned char>::countFrequencies( const unsigned char *data, size_t size ) {
+    Kernels::get().histogram( data, size, frequencies.data() );
+}
+
+/** 
+ * setFrequencies()
+ *
+ * Replaces frequency table with counts
+ * made elsewhere
+ */
+template<typename Symbol>
+void TreeBuilder<Symbol>::setFrequencies( const unsigned long long *counts ) {
+    std::copy( counts, counts + NUM_SYMBOLS, frequencies.begin() );
+}
+
+/** 
+ * getFrequency()
+ *
+ * Returns number of times a symbol was counted
+ */
+template<typename Symbol>
+unsigned long long TreeBuilder<Symbol>::getFrequency( int symbol ) {
+    return frequencies[symbol];
+}
+
+/** 
+ * sortSymbols()
+ *
+ * Fills symbols with every symbol that occurs,
+ * cheapest first and ties broken by symbol value
+ * so trees are the same on every platform.
+ * Returns number of symbols
+ */
+template<typename Symbol>
+int TreeBuilder<Symbol>::sortSymbols( std::vector<int> &symbols ) {
+    symbols.clear();
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( frequencies[s] != 0 ) {
+            symbols.push_back( s );
+        }
+    }
+
+    const unsigned long long *f = frequencies.data();
+
+    std::sort( symbols.begin(), symbols.end(), [f]( int a, int b ) {
+        return f[a] < f[b] || ( f[a] == f[b] && a < b );
+    } );
+
+    return symbols.size();
+}
+
+/** 
+ * getNumSymbols()
+ *
+ * Returns number of distinct symbols counted
+ */
+template<typename Symbol>
+int TreeBuilder<Symbol>::getNumSymbols() {
+    int count = 0;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( frequencies[s] != 0 ) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/** 
+ * build()
+ *
+ * Constructs Huffman Tree with the two-queue method.
+ * Leaves are sorted by frequency once and placed at the
+ * front of the arena; merged nodes are appended after
+ * them and come out in rising frequency, so the arena
+ * itself forms both queues and the two cheapest nodes
+ * are always at one of the two heads. Returns false if
+ * nothing was counted or the codes cannot be stored
+ */
+template<typename Symbol>
+bool TreeBuilder<Symbol>::build() {
+    // Function variables
+    std::vector<int> symbols;
+    int n = sortSymbols( symbols );
+
+    if( n == 0 ) {
+        return false;
+    }
+
+    // Release nodes of any previous tree
+    nodes.clear();
+
+    // Leaves in arena positions 0 to n - 1, cheapest first
+    for( int i = 0; i < n; i++ ) {
+        int leaf = nodes.allocate();
+
+        nodes[leaf].value     = symbols[i];
+        nodes[leaf].frequency = frequencies[symbols[i]];
+    }
+
+    // Heads of the leaf queue and the merged queue
+    int leafHead = 0;
+    int nodeHead = n;
+
+    // Every merge joins the two cheapest heads,
+    // leaves first on ties to keep the tree shallow
+    while( nodes.size() < 2 * n - 1 ) {
+        int z = nodes.allocate();
+
+        for( int child = 0; child < 2; child++ ) {
+            int x;
+
+            if( nodeHead == z || ( leafHead < n && nodes[leafHead].frequency <= nodes[nodeHead].frequency ) ) {
+                x = leafHead++;
+            } else {
+                x = nodeHead++;
+            }
+
+            if( child == 0 ) {
+                nodes[z].left = x;
+            } else {
+                nodes[z].right = x;
+            }
+
+            nodes[z].frequency += nodes[x].frequency;
+        }
+    }
+
+    // Last node made is the root
+    root = nodes.size() - 1;
+
+    // Only the depth of each leaf is kept, codes are
+    // reassigned canonically from these lengths
+    codeTable.clear();
+    buildCodeLengths( root, 0 );
+
+    unlimitedBits = getCodedBits();
+
+    // Rebuild lengths within the limit if the tree is too deep
+    int limit = ( maxCodeLength > 0 ) ? maxCodeLength : BasicCodeTable<Symbol>::MAX_CODE_LENGTH;
+
+    if( codeTable.getMaxLength() > limit ) {
+        limitCodeLengths( limit );
+    }
+
+    return codeTable.assignCanonicalCodes();
+}
+
+/** 
+ * limitCodeLengths()
+ *
+ * Replaces the code lengths with optimal lengths no longer
+ * than limit using package-merge. Every symbol starts as a
+ * coin of its frequency; at each of limit - 1 rounds the
+ * cheapest coins are paired into packages and merged back
+ * with the symbols. A symbol's code length is the number
+ * of times it appears among the 2n - 2 cheapest items of
+ * the final list. The limit is raised if it cannot hold
+ * every symbol
+ */
+template<typename Symbol>
+void TreeBuilder<Symbol>::limitCodeLengths( int limit ) {
+    // Function variables
+    std::vector<PackageItem> items;
+    std::vector<int>         symbols, leaves, list, packages, merged, stack;
+
+    // One leaf item per symbol, cheapest first
+    int n = sortSymbols( symbols );
+
+    for( int i = 0; i < n; i++ ) {
+        PackageItem leaf = { frequencies[symbols[i]], symbols[i], -1, -1 };
+
+        leaves.push_back( items.size() );
+        items.push_back( leaf );
+    }
+
+    // A code of limit bits holds at most 2^limit symbols
+    while( ( 1LL << limit ) < n ) {
+        limit++;
+    }
+
+    list = leaves;
+
+    for( int round = 1; round < limit; round++ ) {
+        // Pair neighbours of the previous list into packages
+        packages.clear();
+
+        for( size_t i = 0; i + 1 < list.size(); i += 2 ) {
+            PackageItem package = { items[list[i]].weight + items[list[i + 1]].weight, -1, list[i], list[i + 1] };
+
+            packages.push_back( items.size() );
+            items.push_back( package );
+        }
+
+        // Merge packages with the leaves, leaves first on ties
+        merged.clear();
+
+        size_t a = 0, b = 0;
+
+        while( a < leaves.size() || b < packages.size() ) {
+            if( b == packages.size() ||
+                ( a < leaves.size() && items[leaves[a]].weight <= items[packages[b]].weight ) ) {
+                merged.push_back( leaves[a++] );
+            } else {
+                merged.push_back( packages[b++] );
+            }
+        }
+
+        list.swap( merged );
+    }
+
+    // Count appearances of each symbol in the cheapest 2n - 2 items
+    codeTable.clear();
+
+    for( int i = 0; i < 2 * n - 2; i++ ) {
+        stack.push_back( list[i] );
+
+        while( !stack.empty() ) {
+            PackageItem &item = items[stack.back()];
+            stack.pop_back();
+
+            if( item.symbol >= 0 ) {
+                codeTable.setLength( item.symbol, codeTable.getLength( item.symbol ) + 1 );
+            } else {
+                stack.push_back( item.left );
+                stack.push_back( item.right );
+            }
+        }
+    }
+}
+
+/** 
+ * getRoot()
+ *
+ * Returns root of the last tree built
+ */
+template<typename Symbol>
+Node* TreeBuilder<Symbol>::getRoot() {
+    return ( root >= 0 ) ? &nodes[root] : NULL;
+}
+
+/** 
+ * getCodeTable()
+ *
+ * Returns canonical codebook built by build()
+ */
+template<typename Symbol>
+BasicCodeTable<Symbol>& TreeBuilder<Symbol>::getCodeTable() {
+    return codeTable;
+}
+
+/** 
+ * getCodedBits()
+ *
+ * Returns number of bits the counted symbols
+ * take with the current code lengths
+ */
+template<typename Symbol>
+unsigned long long TreeBuilder<Symbol>::getCodedBits() {
+    unsigned long long bits = 0;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        bits += frequencies[s] * codeTable.getLength( s );
+    }
+
+    return bits;
+}
+
+/** 
+ * getUnlimitedBits()
+ *
+ * Returns number of bits the counted symbols would
+ * take without a limit on code length
+ */
+template<typename Symbol>
+unsigned long long TreeBuilder<Symbol>::getUnlimitedBits() {
+    return unlimitedBits;
+}
+
+/** 
+ * getEntropyBits()
+ *
+ * Returns the Shannon bound of the counted
+ * symbols, the bits an ideal code would take
+ */
+template<typename Symbol>
+double TreeBuilder<Symbol>::getEntropyBits() {
+    unsigned long long total = 0;
+    double             bits  = 0;
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        total += frequencies[s];
+    }
+
+    for( int s = 0; s < NUM_SYMBOLS; s++ ) {
+        if( frequencies[s] > 0 ) {
+            bits += frequencies[s] * std::log2( (double) total / (double) frequencies[s] );
+        }
+    }
+
+    return bits;
+}
+
+/** 
+ * buildCodeLengths()
+ *
+ * Recursively records the depth of every leaf
+ * as its code length. A lone leaf still needs
+ * one bit per symbol
+ */
+template<typename Symbol>
+void TreeBuilder<Symbol>::buildCodeLengths( int node, int depth ) {
+    if( nodes[node].isLeaf() ) {
+        codeTable.setLength( nodes[node].value, ( depth > 0 ) ? depth : 1 );
+    } else {
+        buildCodeLengths( nodes[node].left,  depth + 1 );
+        buildCodeLengths( nodes[node].right, depth + 1 );
+    }
+}
+
+// Widths the library is built for
+template class TreeBuilder<unsigned char>;
+template class TreeBuilder<uint16_t>;
@@ -0,0 +1,88 @@
+/** 
+ * TreeBuilder.hh
+ *
+ * Class definitions
+ */
+
+#ifndef TREEBUILDER_HH
+#define TREEBUILDER_HH
+
+// Include libraries
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+// Include classes
+#include "Node.hh"
+#include "CodeTable.hh"
+
+/** 
+ * PackageItem
+ *
+ * A symbol or a package of two cheaper items,
+ * used when limiting code lengths
+ */
+struct PackageItem {
+    unsigned long long weight;                                      // Frequency of symbol or sum of pair
+    int                symbol;                                      // Symbol, or -1 for a package
+    int                left;                                        // First item of package
+    int                right;                                       // Second item of package
+};
+
+/** 
+ * TreeBuilder
+ *
+ * Counts symbols and builds their Huffman tree and
+ * canonical code lengths, within a length limit if
+ * one is set. Symbol is unsigned char for bytes or
+ * uint16_t for wide text and pre-tokenized IDs; the
+ * table it fills codes the same alphabet
+ */
+template<typename Symbol>
+class TreeBuilder {
+    public:
+        static const int NUM_SYMBOLS = BasicCodeTable<Symbol>::NUM_SYMBOLS;    // Size of alphabet
+
+        TreeBuilder();                                              // Default constructor: nothing counted
+
+        void setMaxCodeLength( int length );                        // Sets code length limit, 0 for none
+        int  getMaxCodeLength();                                    // Returns code length limit
+
+        void countFrequencies( const Symbol *data, size_t size );   // Adds symbols to frequency table
+        void setFrequencies( const unsigned long long *counts );    // Replaces frequency table
+        unsigned long long getFrequency( int symbol );              // Returns count of a symbol
+        int  sortSymbols( std::vector<int> &symbols );              // Lists symbols cheapest first
+        int  getNumSymbols();                                       // Returns number of distinct symbols
+
+        bool build();                                               // Builds tree and canonical codes
+        void limitCodeLengths( int limit );                         // Package-merge within a length limit
+
+        Node* getRoot();                                            // Returns root node, NULL before build()
+        BasicCodeTable<Symbol>& getCodeTable();                     // Returns canonical codebook
+
+        unsigned long long getCodedBits();                          // Bits needed with current codes
+        unsigned long long getUnlimitedBits();                      // Bits needed without a length limit
+        double getEntropyBits();                                    // Least bits any code could give
+
+    private:
+        void buildCodeLengths( int node, int depth );               // Records depth of every leaf
+
+        NodeArena              nodes;                               // Storage for every node of the tree
+        int                    root;                                // Position of root in nodes, -1 if none
+        std::vector<unsigned long long> frequencies;                // Flat table of symbol frequencies
+        BasicCodeTable<Symbol> codeTable;                           // Codebook of canonical code lengths and words
+        int                    maxCodeLength;                       // Code length limit, 0 for none
+        unsigned long long     unlimitedBits;                       // Bits needed before limiting
+};
+
+template<typename Symbol> const int TreeBuilder<Symbol>::NUM_SYMBOLS;
+
+// Bytes are counted with the histogram kernels
+template<>
+void TreeBuilder<unsigned char>::countFrequencies( const unsigned char *data, size_t size );
+
+// Methods are compiled in TreeBuilder.cc for these widths
+extern template class TreeBuilder<unsigned char>;
+extern template class TreeBuilder<uint16_t>;
+
+#endif
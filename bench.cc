@@ -0,0 +1,442 @@
+/** 
+ * bench.cc
+ *
+ * Application to measure end-to-end throughput of the
+ * encode and decode programs on generated corpora
+ */
+
+// Include libraries
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+// Include class files
+#include "MappedFile.hh"
+#include "Kernels.hh"
+
+/** 
+ * Result
+ *
+ * Measurements of one phase over all runs
+ */
+struct Result {
+    double seconds;                                                 // Fastest wall time
+    long   peakRSS;                                                 // Largest resident set, kilobytes
+    bool   ok;                                                      // Every run exited successfully
+};
+
+/** 
+ * Generator
+ *
+ * Deterministic xorshift generator so every build
+ * is measured on byte-identical corpora
+ */
+class Generator {
+    public:
+        Generator( unsigned long long seed ) : state( seed ) {}
+
+        unsigned long long next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+        // Skewed choice in [0, n), small values most likely
+        int skewed( int n ) {
+            unsigned long long r = next();
+            return (int) ( ( ( r & 0xFFFF ) * ( ( r >> 16 ) & 0xFFFF ) * n ) >> 32 );
+        }
+
+    private:
+        unsigned long long state;
+};
+
+// Corpora that can be generated
+const char *corpora[] = { "text", "logs", "random", "single" };
+const int   numCorpora = 4;
+
+/** 
+ * parseSize()
+ *
+ * Converts a byte count with an optional
+ * K, M or G suffix, returns 0 if malformed
+ */
+unsigned long long parseSize( std::string text ) {
+    char               *end;
+    unsigned long long  size = strtoull( text.c_str(), &end, 10 );
+
+    if( *end == 'K' || *end == 'k' ) {
+        size <<= 10;
+        end++;
+    } else if( *end == 'M' || *end == 'm' ) {
+        size <<= 20;
+        end++;
+    } else if( *end == 'G' || *end == 'g' ) {
+        size <<= 30;
+        end++;
+    }
+
+    return ( *end == '\0' ) ? size : 0;
+}
+
+/** 
+ * fillText()
+ *
+ * Appends words drawn from a small vocabulary with
+ * a skewed distribution, broken into lines
+ */
+void fillText( Generator &gen, std::string &chunk, size_t size ) {
+    static const char *words[] = {
+        "the", "of", "and", "to", "a", "in", "that", "it", "was", "she",
+        "said", "you", "alice", "with", "all", "at", "as", "her", "on", "not",
+        "little", "very", "out", "down", "what", "this", "queen", "thought", "rabbit", "time",
+        "Hatter", "quite", "went", "again", "could", "would", "turtle", "mock", "gryphon", "king"
+    };
+    static const char *marks[] = { " ", " ", " ", " ", " ", ", ", ". ", "; ", "! ", "? " };
+
+    size_t column = 0;
+
+    while( chunk.size() < size ) {
+        const char *word = words[gen.skewed( 40 )];
+
+        chunk += word;
+        chunk += marks[gen.next() % 10];
+        column += strlen( word ) + 2;
+
+        if( column > 70 ) {
+            chunk += '\n';
+            column = 0;
+        }
+    }
+}
+
+/** 
+ * fillLogs()
+ *
+ * Appends log lines with a rising timestamp, a few
+ * levels and services, and skewed status codes
+ */
+void fillLogs( Generator &gen, std::string &chunk, size_t size, unsigned long long &clock ) {
+    static const char *levels[]   = { "INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR" };
+    static const char *services[] = { "api", "auth", "db", "cache", "queue" };
+    static const char *paths[]    = { "/", "/login", "/users", "/orders", "/health", "/search" };
+    static const int   statuses[] = { 200, 200, 200, 200, 201, 204, 304, 400, 404, 500 };
+
+    char line[256];
+
+    while( chunk.size() < size ) {
+        clock += gen.skewed( 50 );
+
+        int length = snprintf( line, sizeof( line ),
+                               "2024-01-%02llu %02llu:%02llu:%02llu.%03llu %s [%s-%d] GET %s status=%d latency=%dms id=%08llx\n",
+                               1 + clock / 86400000 % 28, clock / 3600000 % 24, clock / 60000 % 60,
+                               clock / 1000 % 60, clock % 1000,
+                               levels[gen.skewed( 6 )], services[gen.skewed( 5 )], (int) ( gen.next() % 8 ),
+                               paths[gen.skewed( 6 )], statuses[gen.skewed( 10 )], gen.skewed( 2000 ),
+                               gen.next() & 0xFFFFFFFF );
+
+        chunk.append( line, length );
+    }
+}
+
+/** 
+ * generate()
+ *
+ * Writes size bytes of a corpus to filename a chunk at
+ * a time, so corpora larger than memory can be made.
+ * A file of the right size is assumed to be up to date
+ */
+bool generate( std::string corpus, std::string filename, unsigned long long size ) {
+    // Function variables
+    struct stat        info;
+    std::string        chunk;
+    Generator          gen( 0x9E3779B97F4A7C15ULL );
+    unsigned long long written = 0;
+    unsigned long long clock   = 0;
+    const size_t       CHUNK   = 1 << 20;
+
+    if( stat( filename.c_str(), &info ) == 0 && (unsigned long long) info.st_size == size ) {
+        return true;
+    }
+
+    FILE *file = fopen( filename.c_str(), "wb" );
+
+    if( file == NULL ) {
+        return false;
+    }
+
+    while( written < size ) {
+        size_t want = ( size - written < CHUNK ) ? size - written : CHUNK;
+
+        // Keep text that ran past the last chunk
+        if( chunk.size() < want ) {
+            if( corpus == "text" ) {
+                fillText( gen, chunk, CHUNK );
+            } else if( corpus == "logs" ) {
+                fillLogs( gen, chunk, CHUNK, clock );
+            } else if( corpus == "random" ) {
+                while( chunk.size() < CHUNK ) {
+                    unsigned long long r = gen.next();
+                    chunk.append( (const char *) &r, sizeof( r ) );
+                }
+            } else {
+                chunk.append( CHUNK, 'a' );
+            }
+        }
+
+        if( fwrite( chunk.data(), 1, want, file ) != want ) {
+            fclose( file );
+            return false;
+        }
+
+        chunk.erase( 0, want );
+        written += want;
+    }
+
+    return fclose( file ) == 0;
+}
+
+/** 
+ * now()
+ *
+ * Returns monotonic time in seconds
+ */
+double now() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** 
+ * run()
+ *
+ * Runs a program with its output discarded, returns
+ * wall time and peak resident set of the child
+ */
+bool run( std::vector<std::string> args, double &seconds, long &peakRSS ) {
+    // Function variables
+    std::vector<char *> argv;
+    struct rusage       usage;
+    int                 status;
+
+    for( size_t i = 0; i < args.size(); i++ ) {
+        argv.push_back( &args[i][0] );
+    }
+
+    argv.push_back( NULL );
+
+    double start = now();
+    pid_t  pid   = fork();
+
+    if( pid < 0 ) {
+        return false;
+    }
+
+    if( pid == 0 ) {
+        int null = open( "/dev/null", O_WRONLY );
+
+        dup2( null, STDOUT_FILENO );
+        execv( argv[0], &argv[0] );
+        _exit( 127 );
+    }
+
+    if( wait4( pid, &status, 0, &usage ) != pid ) {
+        return false;
+    }
+
+    seconds = now() - start;
+    peakRSS = usage.ru_maxrss;
+
+    return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+/** 
+ * measure()
+ *
+ * Runs a program several times, keeping the
+ * fastest time and the largest resident set
+ */
+Result measure( std::vector<std::string> args, int runs ) {
+    Result result = { 0, 0, true };
+
+    for( int i = 0; i < runs && result.ok; i++ ) {
+        double seconds;
+        long   peakRSS;
+
+        result.ok = run( args, seconds, peakRSS );
+
+        if( i == 0 || seconds < result.seconds ) {
+            result.seconds = seconds;
+        }
+
+        if( peakRSS > result.peakRSS ) {
+            result.peakRSS = peakRSS;
+        }
+    }
+
+    return result;
+}
+
+/** 
+ * sameContents()
+ *
+ * Checks decoded output matches the corpus
+ */
+bool sameContents( std::string a, std::string b ) {
+    MappedFile first, second;
+
+    if( !first.openRead( a ) || !second.openRead( b ) || first.getSize() != second.getSize() ) {
+        return false;
+    }
+
+    return first.getSize() == 0 || memcmp( first.getData(), second.getData(), first.getSize() ) == 0;
+}
+
+/** 
+ * report()
+ *
+ * Prints one phase as a line of JSON
+ */
+void report( std::string corpus, std::string phase, unsigned long long size,
+             unsigned long long packed, int threads, const Result &result ) {
+    printf( "{\"corpus\":\"%s\",\"phase\":\"%s\",\"kernels\":\"%s\",\"bytes\":%llu,\"packed_bytes\":%llu,"
+            "\"threads\":%d,\"seconds\":%.6f,\"mb_per_s\":%.2f,\"ratio\":%.6f,\"peak_rss_kb\":%ld,\"ok\":%s}\n",
+            corpus.c_str(), phase.c_str(), Kernels::get().name, size, packed, threads, result.seconds,
+            size / 1048576.0 / result.seconds, (double) packed / (double) size,
+            result.peakRSS, result.ok ? "true" : "false" );
+    fflush( stdout );
+}
+
+/** 
+ * main()
+ *
+ * Generates each corpus, then times encoding
+ * and decoding it as separate phases
+ */
+int main( int argc, char *argv[] ) {
+    // Program variables
+    std::vector<std::string> selected;
+    std::string              dir     = "bench-data";
+    std::string              bin     = ".";
+    unsigned long long       size    = 64 << 20;
+    int                      runs    = 3;
+    int                      threads = 0;
+    bool                     failed  = false;
+
+    // Read options from command line
+    for( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+
+        if( arg.find( "--size=" ) == 0 ) {
+            size = parseSize( arg.substr( 7 ) );
+        } else if( arg.find( "--corpus=" ) == 0 ) {
+            selected.push_back( arg.substr( 9 ) );
+        } else if( arg.find( "--runs=" ) == 0 ) {
+            runs = atoi( arg.substr( 7 ).c_str() );
+        } else if( arg.find( "--threads=" ) == 0 ) {
+            threads = atoi( arg.substr( 10 ).c_str() );
+        } else if( arg.find( "--dir=" ) == 0 ) {
+            dir = arg.substr( 6 );
+        } else if( arg.find( "--bin=" ) == 0 ) {
+            bin = arg.substr( 6 );
+        } else {
+            std::cerr << "  Unknown option " << arg << std::endl;
+            std::cerr << "  Options: --size=N[K|M|G] --corpus=NAME --runs=N --threads=N --dir=PATH --bin=PATH" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    if( size == 0 || runs < 1 ) {
+        std::cerr << "  Size and runs must be positive" << std::endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // Every corpus unless some were named
+    if( selected.empty() ) {
+        selected.assign( corpora, corpora + numCorpora );
+    }
+
+    // Every kernel set this CPU runs must match the reference
+    // before any timing is worth reporting
+    bool kernelsOk = Kernels::crossCheck( std::cerr );
+
+    // Report the set a large input is coded with
+    Kernels::prepare( Kernels::CALIBRATION_THRESHOLD );
+
+    printf( "{\"check\":\"kernels\",\"selected\":\"%s\",\"ok\":%s}\n",
+            Kernels::get().name, kernelsOk ? "true" : "false" );
+
+    if( !kernelsOk ) {
+        exit( EXIT_FAILURE );
+    }
+
+    mkdir( dir.c_str(), 0755 );
+
+    for( size_t c = 0; c < selected.size(); c++ ) {
+        std::string corpus = selected[c];
+        bool        known  = false;
+
+        for( int i = 0; i < numCorpora; i++ ) {
+            known = known || corpus == corpora[i];
+        }
+
+        if( !known ) {
+            std::cerr << "  Unknown corpus " << corpus << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        // Files are named by corpus and size so sizes can coexist
+        std::string base = dir + "/" + corpus + "-" + std::to_string( size );
+
+        if( !generate( corpus, base + ".txt", size ) ) {
+            std::cerr << "  Cannot write " << base << ".txt" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        std::vector<std::string> encodeArgs, decodeArgs;
+
+        encodeArgs.push_back( bin + "/encode" );
+        decodeArgs.push_back( bin + "/decode" );
+
+        if( threads > 0 ) {
+            encodeArgs.push_back( "--threads=" + std::to_string( threads ) );
+            decodeArgs.push_back( "--threads=" + std::to_string( threads ) );
+        }
+
+        encodeArgs.push_back( base + ".txt" );
+        decodeArgs.push_back( base + ".huf" );
+
+        Result encoded = measure( encodeArgs, runs );
+
+        struct stat info;
+        unsigned long long packed = ( stat( ( base + ".huf" ).c_str(), &info ) == 0 ) ? info.st_size : 0;
+
+        report( corpus, "encode", size, packed, threads, encoded );
+
+        Result decoded = measure( decodeArgs, runs );
+
+        // A decode that does not reproduce the corpus is a failure
+        decoded.ok = decoded.ok && sameContents( base + ".txt", base + ".decoded.txt" );
+
+        report( corpus, "decode", size, packed, threads, decoded );
+
+        failed = failed || !encoded.ok || !decoded.ok;
+
+        // Keep the corpus for the next build, drop the outputs
+        unlink( ( base + ".huf" ).c_str() );
+        unlink( ( base + ".decoded.txt" ).c_str() );
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+/** 
+ * check.cc
+ *
+ * Application to check code tables round trip
+ * through their header form at every symbol width
+ * and every kernel set against the reference
+ */
+
+// Include libraries
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+
+// Include class files
+#include "TreeBuilder.hh"
+#include "DecodeTable.hh"
+#include "Kernels.hh"
+
+// Stack of the thread that builds a 16-bit table, smaller than one table used to be
+static const size_t SMALL_STACK = 256 << 10;
+
+/** 
+ * fillTokens()
+ *
+ * Fills tokens with a reproducible skewed stream: most
+ * of them from a few hundred common IDs and the rest
+ * spread over the whole 16-bit alphabet
+ */
+void fillTokens( std::vector<uint16_t> &tokens, size_t size ) {
+    unsigned long long state = 1;
+
+    tokens.resize( size );
+
+    for( size_t i = 0; i < size; i++ ) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        unsigned int value = (unsigned int) ( state >> 33 );
+
+        tokens[i] = ( value % 10 != 0 ) ? (uint16_t) ( value % 300 ) : (uint16_t) ( value >> 8 );
+    }
+}
+
+/** 
+ * checkWideTable()
+ *
+ * Builds a length-limited table over 16-bit tokens,
+ * writes it with the coded tokens, reads it back and
+ * decodes every token with the table that was read
+ */
+bool checkWideTable() {
+    typedef BasicCodeTable<uint16_t> WideTable;
+
+    // Function variables
+    std::vector<uint16_t> tokens;
+
+    fillTokens( tokens, 1 << 20 );
+
+    TreeBuilder<uint16_t> tree;
+
+    tree.setMaxCodeLength( 20 );
+    tree.countFrequencies( tokens.data(), tokens.size() );
+
+    if( !tree.build() ) {
+        return false;
+    }
+
+    WideTable &table = tree.getCodeTable();
+
+    if( table.getMaxLength() > 20 ) {
+        return false;
+    }
+
+    std::vector<unsigned char> buffer( WideTable::MAX_HEADER_BYTES + tokens.size() * 4 + 16 );
+    BitIO                      writer( buffer.data(), buffer.size() );
+
+    if( !table.write( writer ) ) {
+        return false;
+    }
+
+    for( size_t i = 0; i < tokens.size(); i++ ) {
+        writer.writeBits( table.getCode( tokens[i] ), table.getLength( tokens[i] ) );
+    }
+
+    writer.pad();
+
+    // Read the table back and compare it entry by entry
+    WideTable copy;
+    BitIO     reader( (const unsigned char *) buffer.data(), writer.getBytesWritten() );
+
+    if( !copy.read( reader ) || copy.getNumSymbols() != table.getNumSymbols() ) {
+        return false;
+    }
+
+    for( int s = 0; s < WideTable::NUM_SYMBOLS; s++ ) {
+        if( copy.getLength( s ) != table.getLength( s ) || copy.getCode( s ) != table.getCode( s ) ) {
+            return false;
+        }
+    }
+
+    // Every token decodes with the table that was read
+    DecodeTable decodeTable;
+
+    decodeTable.build( copy.getLengths(), copy.getCodes(), WideTable::NUM_SYMBOLS );
+
+    for( size_t i = 0; i < tokens.size(); i++ ) {
+        if( decodeTable.decodeSymbol( reader ) != tokens[i] ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** 
+ * checkEmptyTable()
+ *
+ * An empty table has no header form, so
+ * write() refuses it and writes nothing
+ */
+bool checkEmptyTable() {
+    BasicCodeTable<uint16_t> wide;
+    CodeTable                bytes;
+    unsigned char            buffer[16];
+    BitIO                    wideWriter( buffer, sizeof( buffer ) );
+    BitIO                    byteWriter( buffer, sizeof( buffer ) );
+
+    return !wide.write( wideWriter ) && wideWriter.getBytesWritten() == 0 && wideWriter.getNumBits() == 0 &&
+           !bytes.write( byteWriter ) && byteWriter.getBytesWritten() == 0 && byteWriter.getNumBits() == 0;
+}
+
+/** 
+ * buildOnStack()
+ *
+ * Thread body of checkStackBuilder(): builds a 16-bit
+ * table and reads a copy of it back, both on the stack
+ */
+static void *buildOnStack( void *result ) {
+    std::vector<uint16_t>    tokens;
+    TreeBuilder<uint16_t>    tree;
+    BasicCodeTable<uint16_t> copy;
+
+    fillTokens( tokens, 1 << 16 );
+    tree.countFrequencies( tokens.data(), tokens.size() );
+
+    std::vector<unsigned char> buffer( BasicCodeTable<uint16_t>::MAX_HEADER_BYTES + 16 );
+    BitIO                      writer( buffer.data(), buffer.size() );
+
+    bool ok = tree.build() && tree.getCodeTable().write( writer );
+
+    writer.pad();
+
+    BitIO reader( (const unsigned char *) buffer.data(), writer.getBytesWritten() );
+
+    *(bool *) result = ok && copy.read( reader ) && copy.getNumSymbols() == tree.getNumSymbols();
+
+    return NULL;
+}
+
+/** 
+ * checkStackBuilder()
+ *
+ * A 16-bit builder and table on the stack must fit
+ * a thread stack smaller than one inline table
+ */
+bool checkStackBuilder() {
+    pthread_attr_t attributes;
+    pthread_t      thread;
+    bool           ok = false;
+
+    pthread_attr_init( &attributes );
+    pthread_attr_setstacksize( &attributes, SMALL_STACK );
+
+    if( pthread_create( &thread, &attributes, buildOnStack, &ok ) == 0 ) {
+        pthread_join( thread, NULL );
+    }
+
+    pthread_attr_destroy( &attributes );
+
+    return ok;
+}
+
+/** 
+ * checkKernels()
+ *
+ * Every kernel set this CPU runs must write
+ * the same bits as the reference set
+ */
+bool checkKernels() {
+    return Kernels::crossCheck( std::cerr );
+}
+
+/** 
+ * main()
+ *
+ * Runs every check and prints one line of JSON for
+ * each, failing if any of them did not pass
+ */
+int main() {
+    // Program variables
+    bool failed = false;
+
+    struct {
+        const char *name;
+        bool      (*run)();
+    } checks[] = {
+        { "kernels",     checkKernels    },
+        { "wide_table",  checkWideTable  },
+        { "empty_table", checkEmptyTable },
+        { "stack_table", checkStackBuilder }
+    };
+
+    for( size_t i = 0; i < sizeof( checks ) / sizeof( checks[0] ); i++ ) {
+        bool ok = checks[i].run();
+
+        printf( "{\"check\":\"%s\",\"ok\":%s}\n", checks[i].name, ok ? "true" : "false" );
+        failed = failed || !ok;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
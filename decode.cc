@@ -7,11 +7,15 @@
 // Include libraries
 #include <iostream>
 #include <cstdlib>
+#include <cctype>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <unistd.h>
 
 // Include class files
 #include "HuffmanTree.hh"
+#include "MappedFile.hh"
 
 /** 
  * main()
@@ -22,44 +26,148 @@ int main( int argc, char *argv[] ) {
     // Program variables
     size_t      pos;
     std::string input;
+    std::string manifest;
+    std::string range;
+    std::vector<std::string> inputs;
+    SharedTable table;
 
-    // Determine if file names are given via command line
-    if( argc > 1 ) {
-        // Read second argument
-        input = argv[1];
-    } else {
+    // Construct Huffman Tree
+    HuffmanTree HT;
+
+    // A range is written to standard output, so messages go to standard error
+    bool rangeMode = false;
+
+    for( int i = 1; i < argc; i++ ) {
+        rangeMode = rangeMode || std::string( argv[i] ).find( "--range=" ) == 0;
+    }
+
+    std::ostream &messages = rangeMode ? std::cerr : std::cout;
+
+    // Read options and file name from command line
+    for( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+
+        if( arg.find( "--threads=" ) == 0 ) {
+            HT.setNumThreads( atoi( arg.substr( 10 ).c_str() ) );
+        } else if( arg.find( "--table=" ) == 0 ) {
+            if( !table.load( arg.substr( 8 ) ) ) {
+                messages << "  Cannot load shared table " << arg.substr( 8 ) << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            HT.setSharedTable( &table );
+        } else if( arg.find( "--stats=" ) == 0 ) {
+            if( arg.substr( 8 ) == "json" ) {
+                HT.setStatsFormat( STATS_JSON );
+            } else if( arg.substr( 8 ) == "text" ) {
+                HT.setStatsFormat( STATS_TEXT );
+            } else {
+                messages << "  Stats format must be text or json" << std::endl;
+                exit( EXIT_FAILURE );
+            }
+        } else if( arg.find( "--range=" ) == 0 ) {
+            range = arg.substr( 8 );
+        } else if( arg.find( "--files-from=" ) == 0 ) {
+            manifest = arg.substr( 13 );
+        } else {
+            inputs.push_back( arg );
+        }
+    }
+
+    // Several files, a directory or a file list are coded as a batch
+    if( !manifest.empty() || inputs.size() > 1 || ( inputs.size() == 1 && HuffmanTree::isDirectory( inputs[0] ) ) ) {
+        std::vector<std::string> files;
+
+        if( !range.empty() ) {
+            messages << "  A range is read from one file only" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        if( !manifest.empty() && !HuffmanTree::readManifest( manifest, inputs ) ) {
+            messages << "  Cannot read file list " << manifest << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        for( size_t i = 0; i < inputs.size(); i++ ) {
+            HuffmanTree::listFiles( inputs[i], ".huf", files );
+        }
+
+        return ( HT.decodeBatch( files ) == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if( !inputs.empty() ) {
+        input = inputs[0];
+    }
+
+    // Ask for filenames from stdin if none given
+    if( input.empty() ) {
         // Ask for filenames from stdin
-        std::cout << "Which file would you like to decode? ";
+        messages << "Which file would you like to decode? ";
         std::cin >> input;
     }
 
+    // A range is a start offset and a length, written to standard output
+    unsigned long long offset = 0, length = 0;
+
+    if( !range.empty() ) {
+        char *end;
+
+        pos    = range.find( ':' );
+        offset = strtoull( range.c_str(), &end, 10 );
+
+        // Both numbers start with a digit, strtoull would take a sign or an empty start
+        if( pos == std::string::npos || end != range.c_str() + pos || !isdigit( (unsigned char) range[0] ) ||
+            !isdigit( (unsigned char) range[pos + 1] ) ) {
+            messages << "  Range must be START:LENGTH" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        length = strtoull( range.c_str() + pos + 1, &end, 10 );
+
+        if( pos + 1 == range.size() || *end != '\0' ) {
+            messages << "  Range must be START:LENGTH" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        if( input == "-" ) {
+            messages << "  A range needs a file, not standard input" << std::endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    // A dash reads standard input and writes standard output
+    if( input == "-" ) {
+        HT.decodeStream( STDIN_FILENO, STDOUT_FILENO );
+        return EXIT_SUCCESS;
+    }
+
     // Naive check that filename has .huf extension
     pos = input.find( ".huf" );
     if( pos == std::string::npos ) {
-        std::cout << "  Unsupported file. Must have .huf extension" << std::endl;
+        messages << "  Unsupported file. Must have .huf extension" << std::endl;
         exit( EXIT_FAILURE );
     }
 
-    // Construct Huffman Tree
-    HuffmanTree HT;
-
-    // Open file
-    std::ifstream inputFile;
-    inputFile.open( input.c_str(), std::ios::in );
+    // Map file
+    MappedFile inputFile;
 
     // Check if file opens successfully
-    if( !inputFile.good() ) {
-        std::cout << "  Cannot open file" << std::endl;
-        std::cout << "  Exiting ..." << std::endl;
+    if( !inputFile.openRead( input ) ) {
+        messages << "  Cannot open file" << std::endl;
+        messages << "  Exiting ..." << std::endl;
         exit( EXIT_FAILURE );
     }
 
     // Check if empty file
-    if( inputFile.peek() == std::ifstream::traits_type::eof() ) {
-        std::cout << "  This is an empty file. No compression required" << std::endl;
+    if( inputFile.getSize() == 0 ) {
+        messages << "  This is an empty file. No compression required" << std::endl;
         exit(EXIT_FAILURE);
     }
 
+    if( !range.empty() ) {
+        return HT.decodeRange( input, inputFile, offset, length, STDOUT_FILENO ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Let the decoding commence!
     HT.decode( input, inputFile );
 
@@ -9,15 +9,35 @@
 #include <iostream>
 #include <cstdlib>
 #include <string>
+#include <vector>
+#include <unistd.h>
 #include <fstream>
 
 // Include class files
 #include "Node.hh"
-#include "PriorityQueue.hh"
 #include "HuffmanTree.hh"
+#include "MappedFile.hh"
 
+/** 
+ * parseSize()
+ *
+ * Converts a byte count with an optional
+ * K or M suffix, returns 0 if malformed
+ */
+size_t parseSize( std::string text ) {
+    char  *end;
+    size_t size = strtoul( text.c_str(), &end, 10 );
+
+    if( *end == 'K' || *end == 'k' ) {
+        size <<= 10;
+        end++;
+    } else if( *end == 'M' || *end == 'm' ) {
+        size <<= 20;
+        end++;
+    }
 
-
+    return ( *end == '\0' ) ? size : 0;
+}
 
 /** 
  * main()
@@ -28,17 +48,118 @@ int main( int argc, char *argv[] ) {
     // Program variables
     size_t      pos;
     std::string input;
+    std::string manifest;
+    std::vector<std::string> inputs;
+    bool        adaptive = false;
+    bool        verbose  = false;
+    std::string trainFilename;
+    SharedTable table;
+
+    // Construct Huffman Tree
+    HuffmanTree HT;
+
+    // Read options and file name from command line
+    for( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+
+        if( arg.find( "--block-size=" ) == 0 ) {
+            size_t size = parseSize( arg.substr( 13 ) );
+
+            if( size == 0 ) {
+                std::cout << "  Invalid block size " << arg.substr( 13 ) << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            HT.setBlockSize( size );
+        } else if( arg.find( "--threads=" ) == 0 ) {
+            HT.setNumThreads( atoi( arg.substr( 10 ).c_str() ) );
+        } else if( arg.find( "--streams=" ) == 0 ) {
+            int streams = atoi( arg.substr( 10 ).c_str() );
+
+            if( streams != 1 && streams != BlockCodec::NUM_STREAMS ) {
+                std::cout << "  Streams must be 1 or " << BlockCodec::NUM_STREAMS << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            HT.setNumStreams( streams );
+        } else if( arg.find( "--max-code-length=" ) == 0 ) {
+            int length = atoi( arg.substr( 18 ).c_str() );
+
+            if( length < 1 || length > CodeTable::MAX_CODE_LENGTH ) {
+                std::cout << "  Code length limit must be between 1 and " << CodeTable::MAX_CODE_LENGTH << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            HT.setMaxCodeLength( length );
+        } else if( arg.find( "--train=" ) == 0 ) {
+            trainFilename = arg.substr( 8 );
+        } else if( arg.find( "--table=" ) == 0 ) {
+            if( !table.load( arg.substr( 8 ) ) ) {
+                std::cout << "  Cannot load shared table " << arg.substr( 8 ) << std::endl;
+                exit( EXIT_FAILURE );
+            }
+
+            HT.setSharedTable( &table );
+        } else if( arg == "--adaptive" ) {
+            adaptive = true;
+        } else if( arg == "--context" ) {
+            HT.setContextModel( true );
+        } else if( arg == "--verbose" ) {
+            verbose = true;
+        } else if( arg.find( "--stats=" ) == 0 ) {
+            if( arg.substr( 8 ) == "json" ) {
+                HT.setStatsFormat( STATS_JSON );
+            } else if( arg.substr( 8 ) == "text" ) {
+                HT.setStatsFormat( STATS_TEXT );
+            } else {
+                std::cout << "  Stats format must be text or json" << std::endl;
+                exit( EXIT_FAILURE );
+            }
+        } else if( arg.find( "--files-from=" ) == 0 ) {
+            manifest = arg.substr( 13 );
+        } else {
+            inputs.push_back( arg );
+        }
+    }
+
+    // Several files, a directory or a file list are coded as a batch
+    if( !manifest.empty() || inputs.size() > 1 || ( inputs.size() == 1 && HuffmanTree::isDirectory( inputs[0] ) ) ) {
+        std::vector<std::string> files;
+
+        if( !manifest.empty() && !HuffmanTree::readManifest( manifest, inputs ) ) {
+            std::cout << "  Cannot read file list " << manifest << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        for( size_t i = 0; i < inputs.size(); i++ ) {
+            HuffmanTree::listFiles( inputs[i], ".txt", files );
+        }
+
+        return ( HT.encodeBatch( files, adaptive ) == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // Determine if file names are given via command line
-    if( argc > 1 ) {
-        // Read second argument
-        input = argv[1];
-    } else {
+    if( !inputs.empty() ) {
+        input = inputs[0];
+    }
+
+    // Ask for filenames from stdin if none given
+    if( input.empty() ) {
         // Ask for filenames from stdin
         std::cout << "Which file would you like to encode? ";
         std::cin >> input;
     }
 
+    // A dash reads standard input and writes standard output
+    if( input == "-" ) {
+        if( adaptive ) {
+            HT.encodeAdaptiveStream( STDIN_FILENO, STDOUT_FILENO );
+        } else {
+            HT.encodeStream( STDIN_FILENO, STDOUT_FILENO );
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     // Naive check that filename has .txt extension
     pos = input.find( ".txt" );
     if( pos == std::string::npos ) {
@@ -46,43 +167,59 @@ int main( int argc, char *argv[] ) {
         exit( EXIT_FAILURE );
     }
 
-    // Construct Huffman Tree
-    HuffmanTree HT;
-
-    // Open file
-    std::ifstream inputFile;
-    inputFile.open( input.c_str(), std::ios::in );
+    // Map file
+    MappedFile inputFile;
 
     // Check if file opens successfully
-    if( !inputFile.good() ) {
+    if( !inputFile.openRead( input ) ) {
         std::cout << "  Cannot open file" << std::endl;
         std::cout << "  Exiting ..." << std::endl;
         exit( EXIT_FAILURE );
     }
 
     // Check if empty file
-    if( inputFile.peek() == std::ifstream::traits_type::eof() ) {
+    if( inputFile.getSize() == 0 ) {
         std::cout << "  This is an empty file. No compression required" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // Build frequency table
-    HT.countFrequencies( inputFile );
+    // Train a shared table from the file instead of encoding it
+    if( !trainFilename.empty() ) {
+        if( !table.train( inputFile.getData(), inputFile.getSize(), HT.getMaxCodeLength() ) ) {
+            std::cout << "  Cannot build a shared table from this sample" << std::endl;
+            std::cout << "  Exiting..." << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        if( !table.save( trainFilename ) ) {
+            std::cout << "  Error writing shared table" << std::endl;
+            std::cout << "  Exiting..." << std::endl;
+            exit( EXIT_FAILURE );
+        }
 
-    // Print out results
-    HT.printFrequencies();
+        std::cout << "  Shared table " << std::hex << table.getId() << std::dec
+                  << " written to " << trainFilename << std::endl;
 
-    // Build Huffman tree
-    HT.buildHuffmanTree();
+        return EXIT_SUCCESS;
+    }
 
-    // Print out prefix codes
-    HT.printPrefix();
+    // Adaptive coding needs no tables up front
+    if( adaptive ) {
+        HT.encodeAdaptive( input, inputFile );
+        return EXIT_SUCCESS;
+    }
+
+    // Frequencies and codes of the whole file are only printed on request,
+    // every block counts and builds its own
+    if( verbose ) {
+        HT.countFrequencies( inputFile.getData(), inputFile.getSize() );
+        HT.printFrequencies();
+        HT.buildHuffmanTree();
+        HT.printPrefix();
+    }
 
     // Begin encoding
     HT.encode( input, inputFile );
 
-    // Close file
-    inputFile.close();
-
     return EXIT_SUCCESS;
 }
\ No newline at end of file